@@ -21,10 +21,16 @@
  */
 
 #include "astrochrono.h"
+#include "astrochrono_leap.h"
 
+#include <algorithm>
 #include <regex>
 #include <string>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
 
 namespace astrochrono {
 
@@ -41,90 +47,105 @@ static auto constexpr MAX_DAYS = days{106751.99};
 // static double constexpr NSEC_PER_DAY = 86.4e12;
 
 // Difference between Terrestrial Time and TAI.
-static auto constexpr TT_MINUS_TAI = std::chrono::nanoseconds{32184000000LL};
-
-/* Leap second table as string.
- *
- * Source: http://maia.usno.navy.mil/ser7/tai-utc.dat
- */
-static std::string leap_string =
-        "\
-1961 JAN  1 =JD 2437300.5  TAI-UTC=   1.4228180 S + (MJD - 37300.) X 0.001296 S\n\
-1961 AUG  1 =JD 2437512.5  TAI-UTC=   1.3728180 S + (MJD - 37300.) X 0.001296 S\n\
-1962 JAN  1 =JD 2437665.5  TAI-UTC=   1.8458580 S + (MJD - 37665.) X 0.0011232S\n\
-1963 NOV  1 =JD 2438334.5  TAI-UTC=   1.9458580 S + (MJD - 37665.) X 0.0011232S\n\
-1964 JAN  1 =JD 2438395.5  TAI-UTC=   3.2401300 S + (MJD - 38761.) X 0.001296 S\n\
-1964 APR  1 =JD 2438486.5  TAI-UTC=   3.3401300 S + (MJD - 38761.) X 0.001296 S\n\
-1964 SEP  1 =JD 2438639.5  TAI-UTC=   3.4401300 S + (MJD - 38761.) X 0.001296 S\n\
-1965 JAN  1 =JD 2438761.5  TAI-UTC=   3.5401300 S + (MJD - 38761.) X 0.001296 S\n\
-1965 MAR  1 =JD 2438820.5  TAI-UTC=   3.6401300 S + (MJD - 38761.) X 0.001296 S\n\
-1965 JUL  1 =JD 2438942.5  TAI-UTC=   3.7401300 S + (MJD - 38761.) X 0.001296 S\n\
-1965 SEP  1 =JD 2439004.5  TAI-UTC=   3.8401300 S + (MJD - 38761.) X 0.001296 S\n\
-1966 JAN  1 =JD 2439126.5  TAI-UTC=   4.3131700 S + (MJD - 39126.) X 0.002592 S\n\
-1968 FEB  1 =JD 2439887.5  TAI-UTC=   4.2131700 S + (MJD - 39126.) X 0.002592 S\n\
-1972 JAN  1 =JD 2441317.5  TAI-UTC=  10.0       S + (MJD - 41317.) X 0.0      S\n\
-1972 JUL  1 =JD 2441499.5  TAI-UTC=  11.0       S + (MJD - 41317.) X 0.0      S\n\
-1973 JAN  1 =JD 2441683.5  TAI-UTC=  12.0       S + (MJD - 41317.) X 0.0      S\n\
-1974 JAN  1 =JD 2442048.5  TAI-UTC=  13.0       S + (MJD - 41317.) X 0.0      S\n\
-1975 JAN  1 =JD 2442413.5  TAI-UTC=  14.0       S + (MJD - 41317.) X 0.0      S\n\
-1976 JAN  1 =JD 2442778.5  TAI-UTC=  15.0       S + (MJD - 41317.) X 0.0      S\n\
-1977 JAN  1 =JD 2443144.5  TAI-UTC=  16.0       S + (MJD - 41317.) X 0.0      S\n\
-1978 JAN  1 =JD 2443509.5  TAI-UTC=  17.0       S + (MJD - 41317.) X 0.0      S\n\
-1979 JAN  1 =JD 2443874.5  TAI-UTC=  18.0       S + (MJD - 41317.) X 0.0      S\n\
-1980 JAN  1 =JD 2444239.5  TAI-UTC=  19.0       S + (MJD - 41317.) X 0.0      S\n\
-1981 JUL  1 =JD 2444786.5  TAI-UTC=  20.0       S + (MJD - 41317.) X 0.0      S\n\
-1982 JUL  1 =JD 2445151.5  TAI-UTC=  21.0       S + (MJD - 41317.) X 0.0      S\n\
-1983 JUL  1 =JD 2445516.5  TAI-UTC=  22.0       S + (MJD - 41317.) X 0.0      S\n\
-1985 JUL  1 =JD 2446247.5  TAI-UTC=  23.0       S + (MJD - 41317.) X 0.0      S\n\
-1988 JAN  1 =JD 2447161.5  TAI-UTC=  24.0       S + (MJD - 41317.) X 0.0      S\n\
-1990 JAN  1 =JD 2447892.5  TAI-UTC=  25.0       S + (MJD - 41317.) X 0.0      S\n\
-1991 JAN  1 =JD 2448257.5  TAI-UTC=  26.0       S + (MJD - 41317.) X 0.0      S\n\
-1992 JUL  1 =JD 2448804.5  TAI-UTC=  27.0       S + (MJD - 41317.) X 0.0      S\n\
-1993 JUL  1 =JD 2449169.5  TAI-UTC=  28.0       S + (MJD - 41317.) X 0.0      S\n\
-1994 JUL  1 =JD 2449534.5  TAI-UTC=  29.0       S + (MJD - 41317.) X 0.0      S\n\
-1996 JAN  1 =JD 2450083.5  TAI-UTC=  30.0       S + (MJD - 41317.) X 0.0      S\n\
-1997 JUL  1 =JD 2450630.5  TAI-UTC=  31.0       S + (MJD - 41317.) X 0.0      S\n\
-1999 JAN  1 =JD 2451179.5  TAI-UTC=  32.0       S + (MJD - 41317.) X 0.0      S\n\
-2006 JAN  1 =JD 2453736.5  TAI-UTC=  33.0       S + (MJD - 41317.) X 0.0      S\n\
-2009 JAN  1 =JD 2454832.5  TAI-UTC=  34.0       S + (MJD - 41317.) X 0.0      S\n\
-2012 JUL  1 =JD 2456109.5  TAI-UTC=  35.0       S + (MJD - 41317.) X 0.0      S\n\
-2015 JUL  1 =JD 2457204.5  TAI-UTC=  36.0       S + (MJD - 41317.) X 0.0      S\n\
-2017 JAN  1 =JD 2457754.5  TAI-UTC=  37.0       S + (MJD - 41317.) X 0.0      S\n\
-";
+static auto constexpr TT_MINUS_TAI = std::chrono::nanoseconds{detail::TT_MINUS_TAI_NS};
 
 /// Leap second descriptor.
+// TAI - UTC = offset + (MJD - mjd_ref) * drift is evaluated in fixed point, as
+// offset_ns + (utc - ref_ns) * rate / 2^64 with rate the drift in nanoseconds per nanosecond.
 struct Leap {
-    std::int64_t when_utc;  ///< UTC nanosecs of change
-    std::int64_t when_tai;  ///< TAI nanosecs of change
-    double offset;          ///< TAI - UTC
-    double mjd_ref;         ///< Intercept for MJD interpolation
-    double drift;           ///< Slope of MJD interpolation
+    std::int64_t when_utc;       ///< UTC nanosecs of change
+    std::int64_t when_tai;       ///< TAI nanosecs of change
+    std::int64_t offset_ns;      ///< TAI - UTC at ref_ns
+    std::int64_t ref_ns;         ///< UTC nanosecs of the MJD interpolation intercept
+    std::uint64_t rate;          ///< Slope of the interpolation, times 2^64
+    std::uint64_t inverse_rate;  ///< rate / (1 + rate), times 2^64, for the TAI -> UTC direction
 };
 
+// TAI - UTC in nanoseconds at UTC nanosecs utc
+inline std::int64_t tai_minus_utc(Leap const& l, std::int64_t utc) noexcept {
+    return l.offset_ns + detail::multiply_shift(utc - l.ref_ns, l.rate);
+}
+
+// Exact inverse of utc + tai_minus_utc(l, utc): the latest UTC nanosecs that is not after TAI nanosecs tai
+inline std::int64_t utc_from_tai(Leap const& l, std::int64_t tai) noexcept {
+    std::int64_t const x = tai - l.offset_ns;
+    if (l.rate == 0) {
+        return x;
+    }
+    // With y = x - ref_ns the result is ref_ns + floor((y * 2^64 + 2^63 - 1) / (2^64 + rate)).
+    // The inverse_rate estimate of that quotient is off by at most one, which the remainder corrects.
+    std::int64_t const y = x - l.ref_ns;
+    std::int64_t const shift = detail::multiply_shift(y, l.inverse_rate);
+    std::int64_t const q = y - shift;
+    __int128 const remainder = (static_cast<__int128>(shift) << 64) + ((__int128{1} << 63) - 1) -
+                               static_cast<__int128>(q) * static_cast<__int128>(l.rate);
+    __int128 const divisor = (__int128{1} << 64) + l.rate;
+    return l.ref_ns + q - (remainder < 0) + (remainder >= divisor);
+}
+
+// Entries of the table start at least 59 days apart on either time scale, so a bucket of 2^52
+// nanoseconds (52 days) holds at most one start.
+static int constexpr LEAP_BUCKET_SHIFT = 52;
+
 class LeapTable : public std::vector<Leap> {
 public:
-    LeapTable(const char* leap_string);
+    LeapTable();
+
+    // Index of the entry in effect at nsecs on the time scale of the When member, for nsecs not
+    // before the first entry. The bucket of nsecs gives the entry in effect at its start, which
+    // is followed by at most one more.
+    template <std::int64_t Leap::*When>
+    std::size_t index(std::int64_t nsecs) const noexcept {
+        std::vector<std::uint16_t> const& buckets = When == &Leap::when_utc ? utc_buckets : tai_buckets;
+        std::uint64_t const since_first =
+                static_cast<std::uint64_t>(nsecs) - static_cast<std::uint64_t>(front().*When);
+        std::uint64_t const bucket =
+                std::min<std::uint64_t>(since_first >> LEAP_BUCKET_SHIFT, buckets.size() - 1);
+        std::size_t i = buckets[bucket];
+        while (i + 1 < size() && (*this)[i + 1].*When <= nsecs) {
+            ++i;
+        }
+        return i;
+    }
+
+private:
+    template <std::int64_t Leap::*When>
+    std::vector<std::uint16_t> make_buckets() const;
+
+    std::vector<std::uint16_t> utc_buckets;  ///< Entry in effect at the start of each UTC bucket
+    std::vector<std::uint16_t> tai_buckets;  ///< Entry in effect at the start of each TAI bucket
 };
 
-LeapTable leap_table(leap_string.c_str());
+LeapTable leap_table;
 
-LeapTable::LeapTable(const char* leap_string) {
+LeapTable::LeapTable() {
     Leap l;
-    clear();
-    std::regex re(
-            "\\d{4}.*?=JD\\s*([\\d.]+)\\s+TAI-UTC=\\s+([\\d.]+)\\s+S"
-            " \\+ \\(MJD - ([\\d.]+)\\) X ([\\d.]+)\\s*S\n");
-    for (auto i = std::cregex_iterator(leap_string, leap_string + strlen(leap_string), re);
-         i != std::cregex_iterator(); ++i) {
-        auto mjd_utc = static_cast<days>(strtod((*i)[1].first, 0)) - MJD_TO_JD;
-        l.offset = strtod((*i)[2].first, 0);
-        l.mjd_ref = strtod((*i)[3].first, 0);
-        l.drift = strtod((*i)[4].first, 0);
-        l.when_utc = std::chrono::duration_cast<std::chrono::nanoseconds>(mjd_utc - EPOCH_IN_MJD).count();
-        l.when_tai = l.when_utc +
-                     static_cast<std::int64_t>(1.0e9 * (l.offset + (mjd_utc.count() - l.mjd_ref) * l.drift));
+    for (auto const& e : detail::leap_seconds) {
+        l.offset_ns = e.offset_ns;
+        l.ref_ns = detail::leap_ref_ns(e);
+        l.rate = detail::leap_rate(e);
+        l.inverse_rate = detail::leap_inverse_rate(e);
+        l.when_utc = detail::leap_when_utc(e);
+        l.when_tai = l.when_utc + tai_minus_utc(l, l.when_utc);
         push_back(l);
     }
+    utc_buckets = make_buckets<&Leap::when_utc>();
+    tai_buckets = make_buckets<&Leap::when_tai>();
+}
+
+template <std::int64_t Leap::*When>
+std::vector<std::uint16_t> LeapTable::make_buckets() const {
+    std::int64_t const first = front().*When;
+    std::vector<std::uint16_t> buckets(((back().*When - first) >> LEAP_BUCKET_SHIFT) + 1);
+    std::size_t i = 0;
+    for (std::size_t b = 0; b < buckets.size(); ++b) {
+        std::int64_t const start = first + (static_cast<std::int64_t>(b) << LEAP_BUCKET_SHIFT);
+        while (i + 1 < size() && (*this)[i + 1].*When <= start) {
+            ++i;
+        }
+        buckets[b] = static_cast<std::uint16_t>(i);
+    }
+    return buckets;
 }
 
 std::chrono::nanoseconds mjd_to_ns(days mjd) {
@@ -254,23 +275,47 @@ std::string to_string(TimePoint const& tp, const char* suffix) {
     return os.str();
 }
 
+[[noreturn]] void throw_too_early(const char* message) { throw std::domain_error(message); }
+
+// Index of the leap table entry in effect at nsecs, measured on the time scale of the When member
+template <std::int64_t Leap::*When>
+inline std::size_t leap_index(std::int64_t nsecs, const char* too_early) {
+    if (nsecs < leap_table.front().*When) {
+        throw_too_early(too_early);
+    }
+    return leap_table.index<When>(nsecs);
+}
+
+// Segment of the leap table entry in effect at tp, for a source clock that is shifted by
+// source_shift from the time scale of the When member
+template <std::int64_t Leap::*When, typename FromClock>
+timescale_segment<FromClock> leap_segment(typename FromClock::time_point const& tp, std::int64_t source_shift,
+                                          std::int64_t sign, const char* too_early) {
+    std::size_t const i = leap_index<When>(tp.time_since_epoch().count() - source_shift, too_early);
+    Leap const& l(leap_table[i]);
+    timescale_segment<FromClock> segment;
+    segment.first = typename FromClock::time_point{std::chrono::nanoseconds{l.*When + source_shift}};
+    segment.last = i + 1 < leap_table.size() ? typename FromClock::time_point{std::chrono::nanoseconds{
+                                                       leap_table[i + 1].*When + source_shift - 1}}
+                                             : FromClock::time_point::max();
+    segment.offset = std::chrono::nanoseconds{sign * l.offset_ns};
+    segment.is_constant = l.rate == 0;
+    return segment;
+}
+
+template <typename FromClock>
+timescale_segment<FromClock> constant_segment(std::chrono::nanoseconds offset) {
+    return timescale_segment<FromClock>{FromClock::time_point::min(), FromClock::time_point::max(), offset,
+                                        true};
+}
+
 }  // namespace
 
 template <>
 tai_clock::time_point timescale_cast<tai_clock>(utc_clock::time_point const& tp) {
     std::int64_t nsecs = std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
-    size_t i;
-    for (i = 0; i < leap_table.size(); ++i) {
-        if (nsecs < leap_table[i].when_utc) break;
-    }
-    if (i == 0) {
-        throw std::domain_error("DateTime value too early for UTC->TAI conversion");
-    }
-    Leap const& l(leap_table[i - 1]);
-    double mjd = to_mjd(tp).count();
-    double leap_secs = l.offset + (mjd - l.mjd_ref) * l.drift;
-    std::int64_t leap_nsecs = static_cast<std::int64_t>(leap_secs * 1.0e9 + 0.5);
-    return tai_clock::time_point{static_cast<std::chrono::nanoseconds>(nsecs + leap_nsecs)};
+    Leap const& l(leap_table[leap_index<&Leap::when_utc>(nsecs, "DateTime value too early for UTC->TAI conversion")]);
+    return tai_clock::time_point{static_cast<std::chrono::nanoseconds>(nsecs + tai_minus_utc(l, nsecs))};
 }
 
 template <>
@@ -281,21 +326,8 @@ tai_clock::time_point timescale_cast<tai_clock>(tt_clock::time_point const& tp)
 template <>
 utc_clock::time_point timescale_cast<utc_clock>(tai_clock::time_point const& tp) {
     std::int64_t nsecs = std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
-    size_t i;
-    for (i = 0; i < leap_table.size(); ++i) {
-        if (nsecs < leap_table[i].when_tai) break;
-    }
-    if (i == 0) {
-        throw std::domain_error("DateTime value too early for TAI->UTC conversion");
-    }
-    Leap const& l(leap_table[i - 1]);
-    double mjd = to_mjd(tp).count();
-    double leap_secs = l.offset + (mjd - l.mjd_ref) * l.drift;
-    // Correct for TAI MJD vs. UTC MJD.
-    constexpr double SECONDS_PER_DAY = 24. * 3600.;
-    leap_secs /= 1.0 + l.drift / SECONDS_PER_DAY;
-    std::int64_t leap_nsecs = static_cast<std::int64_t>(leap_secs * 1.0e9 + 0.5);
-    return utc_clock::time_point{static_cast<std::chrono::nanoseconds>(nsecs - leap_nsecs)};
+    Leap const& l(leap_table[leap_index<&Leap::when_tai>(nsecs, "DateTime value too early for TAI->UTC conversion")]);
+    return utc_clock::time_point{static_cast<std::chrono::nanoseconds>(utc_from_tai(l, nsecs))};
 }
 
 template <>
@@ -313,6 +345,59 @@ tt_clock::time_point timescale_cast<tt_clock>(utc_clock::time_point const& tp) {
     return timescale_cast<tt_clock>(timescale_cast<tai_clock>(tp));
 }
 
+template <>
+timescale_segment<utc_clock> find_timescale_segment<tai_clock>(utc_clock::time_point const& tp) {
+    return leap_segment<&Leap::when_utc, utc_clock>(tp, 0, 1,
+                                                    "DateTime value too early for UTC->TAI conversion");
+}
+
+template <>
+timescale_segment<tt_clock> find_timescale_segment<tai_clock>(tt_clock::time_point const&) {
+    return constant_segment<tt_clock>(-TT_MINUS_TAI);
+}
+
+template <>
+timescale_segment<tai_clock> find_timescale_segment<utc_clock>(tai_clock::time_point const& tp) {
+    return leap_segment<&Leap::when_tai, tai_clock>(tp, 0, -1,
+                                                    "DateTime value too early for TAI->UTC conversion");
+}
+
+template <>
+timescale_segment<tt_clock> find_timescale_segment<utc_clock>(tt_clock::time_point const& tp) {
+    auto segment = leap_segment<&Leap::when_tai, tt_clock>(tp, TT_MINUS_TAI.count(), -1,
+                                                           "DateTime value too early for TAI->UTC conversion");
+    segment.offset -= TT_MINUS_TAI;
+    return segment;
+}
+
+template <>
+timescale_segment<tai_clock> find_timescale_segment<tt_clock>(tai_clock::time_point const&) {
+    return constant_segment<tai_clock>(TT_MINUS_TAI);
+}
+
+template <>
+timescale_segment<utc_clock> find_timescale_segment<tt_clock>(utc_clock::time_point const& tp) {
+    auto segment = leap_segment<&Leap::when_utc, utc_clock>(tp, 0, 1,
+                                                            "DateTime value too early for UTC->TAI conversion");
+    segment.offset += TT_MINUS_TAI;
+    return segment;
+}
+
+template <>
+timescale_segment<utc_clock> find_timescale_segment<utc_clock>(utc_clock::time_point const&) {
+    return constant_segment<utc_clock>(std::chrono::nanoseconds{0});
+}
+
+template <>
+timescale_segment<tai_clock> find_timescale_segment<tai_clock>(tai_clock::time_point const&) {
+    return constant_segment<tai_clock>(std::chrono::nanoseconds{0});
+}
+
+template <>
+timescale_segment<tt_clock> find_timescale_segment<tt_clock>(tt_clock::time_point const&) {
+    return constant_segment<tt_clock>(std::chrono::nanoseconds{0});
+}
+
 utc_clock::time_point utc_clock::now() {
     struct timeval tv;
     if (gettimeofday(&tv, 0) == 0) {
@@ -415,7 +500,163 @@ std::string to_string<utc_clock::time_point>(utc_clock::time_point const& tp) {
     return to_string(tp, "Z");
 }
 
+namespace {
+
+// JD day number that starts at noon of 1970-01-01
+static constexpr std::int64_t EPOCH_NOON_JD = 2440588;
+
+// Split nanoseconds since the epoch into days since the epoch and nanoseconds into that day.
+// The day is estimated in floating point and corrected with integer arithmetic, which unlike an
+// integer division can be vectorized.
+inline void split_nsecs(std::int64_t nsecs, std::int64_t &day, std::int64_t &nsec_of_day) noexcept {
+    std::int64_t q = static_cast<std::int64_t>(std::floor(static_cast<double>(nsecs) * (1.0 / detail::NSEC_PER_DAY)));
+    // the estimate is off by at most one day, so the remainder is in [-1, 2) days (modulo 2^64)
+    auto r = static_cast<std::int64_t>(static_cast<std::uint64_t>(nsecs) -
+                                       static_cast<std::uint64_t>(q) * static_cast<std::uint64_t>(detail::NSEC_PER_DAY));
+    std::int64_t const correction = (r >= detail::NSEC_PER_DAY) - (r < 0);
+    day = q + correction;
+    nsec_of_day = r - correction * detail::NSEC_PER_DAY;
+}
+
+// Whole days from the epoch beyond which no day overlaps the time_point range
+static constexpr std::int64_t DAY_LIMIT = 106754;
+
+// Nanoseconds since the epoch of day days plus nsecs (in [0, 1.5 days]) nanoseconds.
+// The sum is computed modulo 2^64, ok is cleared when that wrapped around.
+inline std::int64_t join_nsecs(std::int64_t day, std::int64_t nsecs, bool &ok) noexcept {
+    auto const ns = static_cast<std::uint64_t>(day) * static_cast<std::uint64_t>(detail::NSEC_PER_DAY);
+    auto const result = static_cast<std::int64_t>(ns + static_cast<std::uint64_t>(nsecs));
+    // for |day| < DAY_LIMIT a wrapped result has the wrong sign
+    ok = ok && !(day < -1 && result >= 0) && !(day >= 0 && result < 0);
+    return result;
+}
+
+inline std::int64_t fraction_to_nsecs(double fraction) noexcept {
+    return static_cast<std::int64_t>(fraction * static_cast<double>(detail::NSEC_PER_DAY) + 0.5);
+}
+
+inline double nsecs_to_fraction(std::int64_t nsec_of_day) noexcept {
+    return static_cast<double>(nsec_of_day) / static_cast<double>(detail::NSEC_PER_DAY);
+}
+
+template <typename TimePoint>
+inline TimePoint saturate(bool ok, bool below, std::int64_t nsecs) noexcept {
+    std::int64_t const bound =
+            below ? std::numeric_limits<std::int64_t>::min() : std::numeric_limits<std::int64_t>::max();
+    return TimePoint{std::chrono::nanoseconds{ok ? nsecs : bound}};
+}
+
+// Shared loop of the from_mjd and from_jd array conversions from doubles
+template <typename Clock>
+std::size_t from_day_numbers(double const *in, std::size_t n, typename Clock::time_point *out,
+                             std::uint8_t *out_of_range, double epoch) noexcept {
+    // 2^63, the first double above the range of time_point
+    double const limit = -static_cast<double>(std::numeric_limits<std::int64_t>::min());
+    std::size_t bad = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        double const nsecs = (in[i] - epoch) * static_cast<double>(detail::NSEC_PER_DAY);
+        // also false for NaN
+        bool const ok = nsecs >= -limit && nsecs < limit;
+        std::int64_t const rounded = static_cast<std::int64_t>(std::floor((ok ? nsecs : 0.0) + 0.5));
+        out[i] = saturate<typename Clock::time_point>(ok, nsecs < 0.0, rounded);
+        out_of_range[i] = !ok;
+        bad += !ok;
+    }
+    return bad;
+}
+
+// Shared loop of the from_mjd and from_jd array conversions from split_days
+template <typename Clock>
+std::size_t from_day_numbers(split_days const *in, std::size_t n, typename Clock::time_point *out,
+                             std::uint8_t *out_of_range, std::int64_t epoch_day,
+                             std::int64_t day_offset_nsecs) noexcept {
+    std::size_t bad = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        // compare before subtracting the epoch, which could overflow for out of range days
+        std::int64_t const day = in[i].day;
+        double const fraction = in[i].fraction;
+        bool ok = day > epoch_day - DAY_LIMIT && day < epoch_day + DAY_LIMIT && fraction >= 0.0 &&
+                  fraction < 1.0;
+        std::int64_t const nsec_of_day = day_offset_nsecs + fraction_to_nsecs(ok ? fraction : 0.0);
+        std::int64_t const nsecs = join_nsecs(ok ? day - epoch_day : 0, nsec_of_day, ok);
+        out[i] = saturate<typename Clock::time_point>(ok, day < epoch_day, nsecs);
+        out_of_range[i] = !ok;
+        bad += !ok;
+    }
+    return bad;
+}
+
+}  // namespace
+
+template <typename TimePoint>
+void to_mjd(TimePoint const *in, std::size_t n, double *out) noexcept {
+    double const epoch = EPOCH_IN_MJD.count();
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = epoch + static_cast<double>(in[i].time_since_epoch().count()) / detail::NSEC_PER_DAY;
+    }
+}
+
+template <typename TimePoint>
+void to_mjd(TimePoint const *in, std::size_t n, split_days *out) noexcept {
+    for (std::size_t i = 0; i < n; ++i) {
+        std::int64_t day;
+        std::int64_t nsec_of_day;
+        split_nsecs(in[i].time_since_epoch().count(), day, nsec_of_day);
+        out[i].day = day + detail::EPOCH_MJD;
+        out[i].fraction = nsecs_to_fraction(nsec_of_day);
+    }
+}
+
+template <typename TimePoint>
+void to_jd(TimePoint const *in, std::size_t n, double *out) noexcept {
+    double const epoch = (EPOCH_IN_MJD + MJD_TO_JD).count();
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = epoch + static_cast<double>(in[i].time_since_epoch().count()) / detail::NSEC_PER_DAY;
+    }
+}
+
+template <typename TimePoint>
+void to_jd(TimePoint const *in, std::size_t n, split_days *out) noexcept {
+    for (std::size_t i = 0; i < n; ++i) {
+        std::int64_t day;
+        std::int64_t nsec_of_day;
+        split_nsecs(in[i].time_since_epoch().count(), day, nsec_of_day);
+        nsec_of_day += detail::NSEC_PER_DAY / 2;
+        std::int64_t const carry = nsec_of_day >= detail::NSEC_PER_DAY;
+        out[i].day = day + carry + EPOCH_NOON_JD - 1;
+        out[i].fraction = nsecs_to_fraction(nsec_of_day - carry * detail::NSEC_PER_DAY);
+    }
+}
+
+template <typename Clock>
+std::size_t from_mjd(double const *in, std::size_t n, typename Clock::time_point *out,
+                     std::uint8_t *out_of_range) noexcept {
+    return from_day_numbers<Clock>(in, n, out, out_of_range, EPOCH_IN_MJD.count());
+}
+
+template <typename Clock>
+std::size_t from_mjd(split_days const *in, std::size_t n, typename Clock::time_point *out,
+                     std::uint8_t *out_of_range) noexcept {
+    return from_day_numbers<Clock>(in, n, out, out_of_range, detail::EPOCH_MJD, 0);
+}
+
+template <typename Clock>
+std::size_t from_jd(double const *in, std::size_t n, typename Clock::time_point *out,
+                    std::uint8_t *out_of_range) noexcept {
+    return from_day_numbers<Clock>(in, n, out, out_of_range, (EPOCH_IN_MJD + MJD_TO_JD).count());
+}
+
+template <typename Clock>
+std::size_t from_jd(split_days const *in, std::size_t n, typename Clock::time_point *out,
+                    std::uint8_t *out_of_range) noexcept {
+    return from_day_numbers<Clock>(in, n, out, out_of_range, EPOCH_NOON_JD, detail::NSEC_PER_DAY / 2);
+}
+
 // Explicit instantiations
+template struct tm to_gmtime<utc_clock::time_point>(utc_clock::time_point const& tp);
+template struct tm to_gmtime<tai_clock::time_point>(tai_clock::time_point const& tp);
+template struct tm to_gmtime<tt_clock::time_point>(tt_clock::time_point const& tp);
+
 template struct timespec to_timespec<utc_clock::time_point>(utc_clock::time_point const& tp);
 template struct timespec to_timespec<tai_clock::time_point>(tai_clock::time_point const& tp);
 template struct timespec to_timespec<tt_clock::time_point>(tt_clock::time_point const& tp);
@@ -424,4 +665,61 @@ template struct timeval to_timeval<utc_clock::time_point>(utc_clock::time_point
 template struct timeval to_timeval<tai_clock::time_point>(tai_clock::time_point const& tp);
 template struct timeval to_timeval<tt_clock::time_point>(tt_clock::time_point const& tp);
 
-}  // namespace astrochrono
\ No newline at end of file
+
+template void to_mjd<utc_clock::time_point>(utc_clock::time_point const *in, std::size_t n,
+                                            double *out) noexcept;
+template void to_mjd<tai_clock::time_point>(tai_clock::time_point const *in, std::size_t n,
+                                            double *out) noexcept;
+template void to_mjd<tt_clock::time_point>(tt_clock::time_point const *in, std::size_t n,
+                                           double *out) noexcept;
+
+template void to_mjd<utc_clock::time_point>(utc_clock::time_point const *in, std::size_t n,
+                                            split_days *out) noexcept;
+template void to_mjd<tai_clock::time_point>(tai_clock::time_point const *in, std::size_t n,
+                                            split_days *out) noexcept;
+template void to_mjd<tt_clock::time_point>(tt_clock::time_point const *in, std::size_t n,
+                                           split_days *out) noexcept;
+
+template void to_jd<utc_clock::time_point>(utc_clock::time_point const *in, std::size_t n,
+                                           double *out) noexcept;
+template void to_jd<tai_clock::time_point>(tai_clock::time_point const *in, std::size_t n,
+                                           double *out) noexcept;
+template void to_jd<tt_clock::time_point>(tt_clock::time_point const *in, std::size_t n,
+                                          double *out) noexcept;
+
+template void to_jd<utc_clock::time_point>(utc_clock::time_point const *in, std::size_t n,
+                                           split_days *out) noexcept;
+template void to_jd<tai_clock::time_point>(tai_clock::time_point const *in, std::size_t n,
+                                           split_days *out) noexcept;
+template void to_jd<tt_clock::time_point>(tt_clock::time_point const *in, std::size_t n,
+                                          split_days *out) noexcept;
+
+template std::size_t from_mjd<utc_clock>(double const *in, std::size_t n, utc_clock::time_point *out,
+                                         std::uint8_t *out_of_range) noexcept;
+template std::size_t from_mjd<tai_clock>(double const *in, std::size_t n, tai_clock::time_point *out,
+                                         std::uint8_t *out_of_range) noexcept;
+template std::size_t from_mjd<tt_clock>(double const *in, std::size_t n, tt_clock::time_point *out,
+                                        std::uint8_t *out_of_range) noexcept;
+
+template std::size_t from_mjd<utc_clock>(split_days const *in, std::size_t n, utc_clock::time_point *out,
+                                         std::uint8_t *out_of_range) noexcept;
+template std::size_t from_mjd<tai_clock>(split_days const *in, std::size_t n, tai_clock::time_point *out,
+                                         std::uint8_t *out_of_range) noexcept;
+template std::size_t from_mjd<tt_clock>(split_days const *in, std::size_t n, tt_clock::time_point *out,
+                                        std::uint8_t *out_of_range) noexcept;
+
+template std::size_t from_jd<utc_clock>(double const *in, std::size_t n, utc_clock::time_point *out,
+                                        std::uint8_t *out_of_range) noexcept;
+template std::size_t from_jd<tai_clock>(double const *in, std::size_t n, tai_clock::time_point *out,
+                                        std::uint8_t *out_of_range) noexcept;
+template std::size_t from_jd<tt_clock>(double const *in, std::size_t n, tt_clock::time_point *out,
+                                       std::uint8_t *out_of_range) noexcept;
+
+template std::size_t from_jd<utc_clock>(split_days const *in, std::size_t n, utc_clock::time_point *out,
+                                        std::uint8_t *out_of_range) noexcept;
+template std::size_t from_jd<tai_clock>(split_days const *in, std::size_t n, tai_clock::time_point *out,
+                                        std::uint8_t *out_of_range) noexcept;
+template std::size_t from_jd<tt_clock>(split_days const *in, std::size_t n, tt_clock::time_point *out,
+                                       std::uint8_t *out_of_range) noexcept;
+
+}  // namespace astrochrono
@@ -23,7 +23,10 @@
 #ifndef ASTROCHRONO_H
 #define ASTROCHRONO_H
 
+#include <algorithm>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <ctime>
 #include <limits>
 #include <sys/time.h>
@@ -110,6 +113,107 @@ tt_clock::time_point timescale_cast<tt_clock>(tai_clock::time_point const &);
 template <>
 tt_clock::time_point timescale_cast<tt_clock>(utc_clock::time_point const &);
 
+template <>
+inline utc_clock::time_point timescale_cast<utc_clock>(utc_clock::time_point const &tp) {
+    return tp;
+}
+
+template <>
+inline tai_clock::time_point timescale_cast<tai_clock>(tai_clock::time_point const &tp) {
+    return tp;
+}
+
+template <>
+inline tt_clock::time_point timescale_cast<tt_clock>(tt_clock::time_point const &tp) {
+    return tp;
+}
+
+// Closed range [first, last] of FromClock time points covered by a single leap second table entry
+// for a conversion to another clock. If is_constant the conversion adds offset to every time
+// point in the range, otherwise (pre-1972 entries with a drift term) it varies within the range.
+template <typename FromClock>
+struct timescale_segment {
+    typename FromClock::time_point first;
+    typename FromClock::time_point last;
+    std::chrono::nanoseconds offset;
+    bool is_constant;
+};
+
+// Segment containing tp for timescale_cast<ToClock>
+template <typename ToClock, typename TimePoint>
+timescale_segment<typename TimePoint::clock> find_timescale_segment(TimePoint const &);
+
+template <>
+timescale_segment<utc_clock> find_timescale_segment<tai_clock>(utc_clock::time_point const &);
+
+template <>
+timescale_segment<tt_clock> find_timescale_segment<tai_clock>(tt_clock::time_point const &);
+
+template <>
+timescale_segment<tai_clock> find_timescale_segment<utc_clock>(tai_clock::time_point const &);
+
+template <>
+timescale_segment<tt_clock> find_timescale_segment<utc_clock>(tt_clock::time_point const &);
+
+template <>
+timescale_segment<tai_clock> find_timescale_segment<tt_clock>(tai_clock::time_point const &);
+
+template <>
+timescale_segment<utc_clock> find_timescale_segment<tt_clock>(utc_clock::time_point const &);
+
+template <>
+timescale_segment<utc_clock> find_timescale_segment<utc_clock>(utc_clock::time_point const &);
+
+template <>
+timescale_segment<tai_clock> find_timescale_segment<tai_clock>(tai_clock::time_point const &);
+
+template <>
+timescale_segment<tt_clock> find_timescale_segment<tt_clock>(tt_clock::time_point const &);
+
+// Convert n time points from in to out.
+// Runs of time points in a constant segment are converted by a single vectorizable offset add,
+// the per time point conversion is only used for pre-1972 entries.
+template <typename ToClock, typename TimePoint>
+void timescale_cast(TimePoint const *in, std::size_t n, typename ToClock::time_point *out) {
+    using to_time_point = typename ToClock::time_point;
+    std::size_t constexpr chunk = 1024;
+    std::size_t i = 0;
+    while (i < n) {
+        auto const segment = find_timescale_segment<ToClock>(in[i]);
+        if (!segment.is_constant) {
+            for (; i < n && in[i] >= segment.first && in[i] <= segment.last; ++i) {
+                out[i] = timescale_cast<ToClock>(in[i]);
+            }
+            continue;
+        }
+        auto const first = segment.first.time_since_epoch().count();
+        auto const last = segment.last.time_since_epoch().count();
+        while (i < n) {
+            // Whole chunks inside the segment are detected with a min/max reduction
+            std::size_t const m = std::min(chunk, n - i);
+            auto lo = in[i].time_since_epoch().count();
+            auto hi = lo;
+            for (std::size_t j = 1; j < m; ++j) {
+                auto const t = in[i + j].time_since_epoch().count();
+                lo = t < lo ? t : lo;
+                hi = t > hi ? t : hi;
+            }
+            std::size_t k = m;
+            if (lo < first || hi > last) {
+                for (k = 0; k < m && in[i + k] >= segment.first && in[i + k] <= segment.last; ++k) {
+                }
+            }
+            for (std::size_t j = 0; j < k; ++j) {
+                out[i + j] = to_time_point{in[i + j].time_since_epoch() + segment.offset};
+            }
+            i += k;
+            if (k < m) {
+                break;
+            }
+        }
+    }
+}
+
 template <typename TimePoint>
 struct tm to_gmtime(TimePoint const &tp);
 
@@ -132,6 +236,106 @@ constexpr days to_jd(TimePoint const &tp) noexcept {
     return to_mjd(tp) + MJD_TO_JD;
 }
 
+// MJD or JD as an integer day number and the fraction of that day in [0, 1).
+// Unlike a single double this is exact to well below a nanosecond over the whole time_point range.
+struct split_days {
+    std::int64_t day;
+    double fraction;
+};
+
+// Array conversions to MJD and JD.
+// The double results equal those of the scalar to_mjd and to_jd, split_days are exact.
+template <typename TimePoint>
+void to_mjd(TimePoint const *in, std::size_t n, double *out) noexcept;
+
+template <typename TimePoint>
+void to_mjd(TimePoint const *in, std::size_t n, split_days *out) noexcept;
+
+template <typename TimePoint>
+void to_jd(TimePoint const *in, std::size_t n, double *out) noexcept;
+
+template <typename TimePoint>
+void to_jd(TimePoint const *in, std::size_t n, split_days *out) noexcept;
+
+// Array conversions from MJD and JD, rounded to the nearest nanosecond (split_days round trip exactly).
+// Instead of throwing, values outside the range of time_point are flagged with out_of_range[i] = 1
+// (0 otherwise) and saturate to time_point::min() below and time_point::max() above the range (or for NaN).
+// Returns the number of flagged values.
+template <typename Clock>
+std::size_t from_mjd(double const *in, std::size_t n, typename Clock::time_point *out,
+                     std::uint8_t *out_of_range) noexcept;
+
+template <typename Clock>
+std::size_t from_mjd(split_days const *in, std::size_t n, typename Clock::time_point *out,
+                     std::uint8_t *out_of_range) noexcept;
+
+template <typename Clock>
+std::size_t from_jd(double const *in, std::size_t n, typename Clock::time_point *out,
+                    std::uint8_t *out_of_range) noexcept;
+
+template <typename Clock>
+std::size_t from_jd(split_days const *in, std::size_t n, typename Clock::time_point *out,
+                    std::uint8_t *out_of_range) noexcept;
+
+namespace detail {
+
+static constexpr std::int64_t NSEC_PER_SEC = 1000000000LL;
+static constexpr std::int64_t NSEC_PER_DAY = 86400LL * NSEC_PER_SEC;
+
+// MJD of the 1970-01-01 epoch as an integer day count
+static constexpr std::int64_t EPOCH_MJD = 40587;
+
+// Range of whole days since the epoch for which every nanosecond of the day fits in 64 bits
+static constexpr std::int64_t MIN_EPOCH_DAYS = -106751;
+static constexpr std::int64_t MAX_EPOCH_DAYS = 106750;
+
+// Integer division and remainder rounding towards negative infinity
+constexpr std::int64_t floor_div(std::int64_t a, std::int64_t b) noexcept {
+    return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+}
+
+constexpr std::int64_t floor_mod(std::int64_t a, std::int64_t b) noexcept { return a - floor_div(a, b) * b; }
+
+constexpr std::int64_t power_of_10(int n) noexcept { return n == 0 ? 1 : 10 * power_of_10(n - 1); }
+
+struct civil_date {
+    std::int64_t year;
+    unsigned month;  // [1, 12]
+    unsigned day;    // [1, 31]
+};
+
+// Days since 1970-01-01 of a date in the proleptic Gregorian calendar
+// (see http://howardhinnant.github.io/date_algorithms.html)
+constexpr std::int64_t days_from_civil(std::int64_t y, unsigned m, unsigned d) noexcept {
+    y -= m <= 2;
+    std::int64_t const era = (y >= 0 ? y : y - 399) / 400;
+    unsigned const yoe = static_cast<unsigned>(y - era * 400);
+    unsigned const doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned const doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+// Inverse of days_from_civil
+constexpr civil_date civil_from_days(std::int64_t z) noexcept {
+    z += 719468;
+    std::int64_t const era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned const doe = static_cast<unsigned>(z - era * 146097);
+    unsigned const yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned const doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned const mp = (5 * doy + 2) / 153;
+    unsigned const d = doy - (153 * mp + 2) / 5 + 1;
+    unsigned const m = mp < 10 ? mp + 3 : mp - 9;
+    return civil_date{static_cast<std::int64_t>(yoe) + era * 400 + (m <= 2), m, d};
+}
+
+constexpr bool is_leap_year(std::int64_t y) noexcept { return y % 4 == 0 && (y % 100 != 0 || y % 400 == 0); }
+
+constexpr unsigned days_in_month(std::int64_t y, unsigned m) noexcept {
+    return m == 2 ? (is_leap_year(y) ? 29 : 28) : (m == 4 || m == 6 || m == 9 || m == 11) ? 30 : 31;
+}
+
+}  // namespace detail
+
 }  // namespace astrochrono
 
 #endif  // ASTROCHRONO_H
@@ -0,0 +1,311 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+#include "astrochrono_barycentric.h"
+#include "astrochrono_epv00.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace astrochrono {
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double DEG = PI / 180;
+constexpr double ARCSEC = DEG / 3600;
+
+constexpr double SPEED_OF_LIGHT = 299792458.0;         // m/s
+constexpr double AU_LIGHT_SECONDS = 499.004783836;     // astronomical unit in light seconds
+
+// TT (and UTC) nanosecs of J2000.0, 2000-01-01T12:00:00
+constexpr std::int64_t J2000_NSECS = 946728000LL * detail::NSEC_PER_SEC;
+constexpr double NSEC_PER_CENTURY = 36525.0 * detail::NSEC_PER_DAY;
+constexpr double SECONDS_PER_YEAR = 365.25 * 86400;  // Julian year
+
+// Earth rotation angle per second of UT1
+constexpr double EARTH_ROTATION_RATE = 2 * PI * 1.00273781191135448 / 86400;
+
+// Longest span of a block of times sharing one evaluation of the model; the observatory term
+// polynomials below are accurate to 1e-15 for Earth rotation angles of up to an hour either way
+constexpr std::int64_t MAX_CACHE_SPAN = 2 * 3600 * detail::NSEC_PER_SEC;
+
+// Number of times processed at once
+constexpr std::size_t BLOCK_SIZE = 256;
+
+struct vec3 {
+    double x;
+    double y;
+    double z;
+};
+
+// Sum of the terms of a series at t
+template <std::size_t N>
+double series(detail::ephemeris_term const (&terms)[N], double t) {
+    double sum = 0;
+    for (auto const &term : terms) {
+        sum += term.a * std::cos(term.b + term.c * t);
+    }
+    return sum;
+}
+
+// Coordinate in AU from the series of its t^0, t^1 and t^2 terms
+template <std::size_t N0, std::size_t N1, std::size_t N2>
+double coordinate(detail::ephemeris_term const (&s0)[N0], detail::ephemeris_term const (&s1)[N1],
+                  detail::ephemeris_term const (&s2)[N2], double t) {
+    return series(s0, t) + t * (series(s1, t) + t * series(s2, t));
+}
+
+// Center the light travel time is corrected to
+enum class center { barycenter, sun };
+
+// ICRS position of the geocenter relative to center in light seconds, from the IAU SOFA epv00
+// ephemeris; t in Julian years of TDB since J2000
+vec3 earth_position(center to, double t) {
+    using namespace detail;
+    double x = coordinate(earth_x0, earth_x1, earth_x2, t);
+    double y = coordinate(earth_y0, earth_y1, earth_y2, t);
+    double z = coordinate(earth_z0, earth_z1, earth_z2, t);
+    if (to == center::barycenter) {
+        x += coordinate(sun_x0, sun_x1, sun_x2, t);
+        y += coordinate(sun_y0, sun_y1, sun_y2, t);
+        z += coordinate(sun_z0, sun_z1, sun_z2, t);
+    }
+    // frame of the series to ICRS, as in epv00
+    return vec3{(x + 0.000000211284 * y - 0.000000091603 * z) * AU_LIGHT_SECONDS,
+                (-0.000000230286 * x + 0.917482137087 * y - 0.397776982902 * z) * AU_LIGHT_SECONDS,
+                (0.397776982902 * y + 0.917482137087 * z) * AU_LIGHT_SECONDS};
+}
+
+// TDB - TT in seconds, T in Julian centuries since J2000
+double tdb_minus_tt(double T) {
+    return 0.001657 * std::sin(628.3076 * T + 6.2401) + 0.000022 * std::sin(575.3385 * T + 4.2970) +
+           0.000014 * std::sin(1256.6152 * T + 6.1969) + 0.000005 * std::sin(606.9777 * T + 4.0212) +
+           0.000005 * std::sin(52.9691 * T + 0.4444) + 0.000002 * std::sin(21.3299 * T + 5.5431) +
+           0.000010 * T * std::sin(628.3076 * T + 4.2490);
+}
+
+double centuries(std::int64_t tt) { return static_cast<double>(tt - J2000_NSECS) / NSEC_PER_CENTURY; }
+
+/* Light travel time terms of a target, the direction being fixed and the observatory turning with the Earth.
+ *
+ * The projection of the observatory on the direction is amplitude * cos(phase) + constant, with
+ * phase = GMST + observatory longitude - right ascension of date.
+ */
+struct target {
+    vec3 direction;        // ICRS unit vector
+    double ra;             // of J2000
+    double dec;
+    double radius;         // distance of the observatory from the Earth axis, light seconds
+    double height;         // distance of the observatory from the equator, light seconds
+    double longitude;      // of the observatory, radians
+    center to;
+    bool tdb;
+
+    target(sky_direction const &d, observatory_position const &o, center c, bool to_tdb)
+            : direction{std::cos(d.dec) * std::cos(d.ra), std::cos(d.dec) * std::sin(d.ra), std::sin(d.dec)},
+              ra(d.ra),
+              dec(d.dec),
+              radius(std::hypot(o.x, o.y) / SPEED_OF_LIGHT),
+              height(o.z / SPEED_OF_LIGHT),
+              longitude(std::atan2(o.y, o.x)),
+              to(c),
+              tdb(to_tdb) {}
+
+    // Light travel time from the geocenter to the center along the direction, plus TDB - TT
+    double geocenter_term(std::int64_t tt) const {
+        double const T = centuries(tt);
+        double const tdb_tt = tdb_minus_tt(T);
+        vec3 const r = earth_position(to, 100 * T + tdb_tt / SECONDS_PER_YEAR);
+        return r.x * direction.x + r.y * direction.y + r.z * direction.z + (tdb ? tdb_tt : 0.0);
+    }
+
+    // Amplitude, phase and constant of the observatory term at TT tt and UTC utc
+    void observatory_term(std::int64_t tt, std::int64_t utc, double &amplitude, double &phase,
+                          double &constant) const {
+        double const T = centuries(tt);
+        // Earth rotation angle, with UT1 = UTC, and Greenwich mean sidereal time (IAU 2006)
+        std::int64_t const since_j2000 = utc - J2000_NSECS;
+        std::int64_t const day = detail::floor_div(since_j2000, detail::NSEC_PER_DAY);
+        double const fraction = static_cast<double>(since_j2000 - day * detail::NSEC_PER_DAY) / detail::NSEC_PER_DAY;
+        double const era =
+                2 * PI * (0.7790572732640 + 0.00273781191135448 * (static_cast<double>(day) + fraction) + fraction);
+        double const gmst = era + (0.014506 + 4612.156534 * T + 1.3915817 * T * T) * ARCSEC;
+        // precession of the direction to the mean equator and equinox of date (IAU 1976)
+        double const zeta = (2306.2181 + (0.30188 + 0.017998 * T) * T) * T * ARCSEC;
+        double const z = (2306.2181 + (1.09468 + 0.018203 * T) * T) * T * ARCSEC;
+        double const theta = (2004.3109 - (0.42665 + 0.041833 * T) * T) * T * ARCSEC;
+        double const a = std::cos(dec) * std::sin(ra + zeta);
+        double const b = std::cos(theta) * std::cos(dec) * std::cos(ra + zeta) - std::sin(theta) * std::sin(dec);
+        double const c = std::sin(theta) * std::cos(dec) * std::cos(ra + zeta) + std::cos(theta) * std::sin(dec);
+        double const ra_of_date = std::atan2(a, b) + z;
+        amplitude = radius * std::hypot(a, b);
+        phase = gmst + longitude - ra_of_date;
+        constant = height * c;
+    }
+};
+
+/* Model of the delays over a window of at most MAX_CACHE_SPAN around mid.
+ *
+ * The geocenter term is interpolated quadratically and the observatory term cos(phase + w), with
+ * w the Earth rotation since mid, is expanded as cos(phase) cos(w) - sin(phase) sin(w) with Taylor
+ * polynomials for cos(w) and sin(w).
+ */
+struct delay_cache {
+    bool valid = false;
+    std::int64_t first = 0;  // window of TT nanosecs covered
+    std::int64_t last = 0;
+    std::int64_t mid = 0;
+    double c0 = 0;  // geocenter term polynomial in seconds since mid
+    double c1 = 0;
+    double c2 = 0;
+    double a = 0;  // observatory term at mid, amplitude * cos(phase), amplitude * sin(phase)
+    double b = 0;
+    double constant = 0;
+
+    void fill(target const &t, std::int64_t window_first, std::int64_t window_last) {
+        first = window_first;
+        last = window_last;
+        std::int64_t const h = std::max<std::int64_t>((last - first) / 2, 60 * detail::NSEC_PER_SEC);
+        mid = first + (last - first) / 2;
+        double const f0 = t.geocenter_term(mid);
+        double const f1 = t.geocenter_term(mid - h);
+        double const f2 = t.geocenter_term(mid + h);
+        double const hs = static_cast<double>(h) / detail::NSEC_PER_SEC;
+        c0 = f0;
+        c1 = (f2 - f1) / (2 * hs);
+        c2 = (f2 - 2 * f0 + f1) / (2 * hs * hs);
+        std::int64_t const utc =
+                timescale_cast<utc_clock>(tt_clock::time_point{std::chrono::nanoseconds{mid}}).time_since_epoch().count();
+        double amplitude, phase;
+        t.observatory_term(mid, utc, amplitude, phase, constant);
+        a = amplitude * std::cos(phase);
+        b = amplitude * std::sin(phase);
+        valid = true;
+    }
+
+    void delays(std::int64_t const *tt, std::size_t n, double *out) const {
+        for (std::size_t i = 0; i < n; ++i) {
+            double const dt = static_cast<double>(tt[i] - mid) / detail::NSEC_PER_SEC;
+            double const w = EARTH_ROTATION_RATE * dt;
+            double const w2 = w * w;
+            double const cos_w =
+                    1 + w2 * (-1.0 / 2 + w2 * (1.0 / 24 + w2 * (-1.0 / 720 + w2 * (1.0 / 40320 - w2 / 3628800))));
+            double const sin_w = w * (1 + w2 * (-1.0 / 6 + w2 * (1.0 / 120 + w2 * (-1.0 / 5040 +
+                                                                                w2 * (1.0 / 362880 - w2 / 39916800)))));
+            out[i] = c0 + dt * (c1 + dt * c2) + a * cos_w - b * sin_w + constant;
+        }
+    }
+};
+
+// Delays in seconds to add to n TT times tt (with UTC times utc, or nullptr to convert tt) for
+// the arrival times at the center of target, from the cache if the times fit in a window of cache_span
+void block_delays(target const &t, std::int64_t const *tt, std::int64_t const *utc, std::size_t n,
+                  std::int64_t cache_span, delay_cache &cache, double *delays) {
+    auto const range = std::minmax_element(tt, tt + n);
+    std::int64_t const first = *range.first;
+    std::int64_t const last = *range.second;
+    std::int64_t const window = std::min(cache_span, MAX_CACHE_SPAN);
+    // span of the block, without overflow for times far apart
+    std::uint64_t const span = static_cast<std::uint64_t>(last) - static_cast<std::uint64_t>(first);
+    if (window > 0 && span <= static_cast<std::uint64_t>(window)) {
+        if (!cache.valid || first < cache.first || last > cache.last) {
+            // open the window at the block, for sorted input the following blocks fall in it too
+            std::int64_t const window_last =
+                    first <= std::numeric_limits<std::int64_t>::max() - window ? first + window : last;
+            cache.fill(t, first, window_last);
+        }
+        cache.delays(tt, n, delays);
+        return;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        std::int64_t const u = utc ? utc[i]
+                                   : timescale_cast<utc_clock>(tt_clock::time_point{std::chrono::nanoseconds{tt[i]}})
+                                             .time_since_epoch()
+                                             .count();
+        double amplitude, phase, constant;
+        t.observatory_term(tt[i], u, amplitude, phase, constant);
+        delays[i] = t.geocenter_term(tt[i]) + amplitude * std::cos(phase) + constant;
+    }
+}
+
+template <typename TimePoint, typename OutTimePoint>
+void arrival_times(TimePoint const *in, std::size_t n, target const &t, OutTimePoint *out,
+                   std::chrono::nanoseconds cache_span) {
+    std::int64_t tt[BLOCK_SIZE];
+    std::int64_t original[BLOCK_SIZE];
+    double delays[BLOCK_SIZE];
+    tt_clock::time_point converted[BLOCK_SIZE];
+    bool const is_utc = std::is_same<TimePoint, utc_clock::time_point>::value;
+    delay_cache cache;
+    for (std::size_t first = 0; first < n; first += BLOCK_SIZE) {
+        std::size_t const m = std::min(BLOCK_SIZE, n - first);
+        timescale_cast<tt_clock>(in + first, m, converted);
+        for (std::size_t i = 0; i < m; ++i) {
+            tt[i] = converted[i].time_since_epoch().count();
+            original[i] = in[first + i].time_since_epoch().count();
+        }
+        block_delays(t, tt, is_utc ? original : nullptr, m, cache_span.count(), cache, delays);
+        // TDB is corrected from TT, the heliocentric times on the time scale of the input
+        std::int64_t const *base = t.tdb ? tt : original;
+        for (std::size_t i = 0; i < m; ++i) {
+            out[first + i] = OutTimePoint{std::chrono::nanoseconds{base[i] + std::llround(delays[i] * 1e9)}};
+        }
+    }
+}
+
+}  // namespace
+
+tdb_clock::time_point to_tdb(tt_clock::time_point const &tp) {
+    std::int64_t const tt = tp.time_since_epoch().count();
+    return tdb_clock::time_point{std::chrono::nanoseconds{tt + std::llround(tdb_minus_tt(centuries(tt)) * 1e9)}};
+}
+
+void barycentric_times(tt_clock::time_point const *in, std::size_t n, sky_direction const &direction,
+                       observatory_position const &observatory, tdb_clock::time_point *out,
+                       std::chrono::nanoseconds cache_span) {
+    arrival_times(in, n, target(direction, observatory, center::barycenter, true), out, cache_span);
+}
+
+void barycentric_times(utc_clock::time_point const *in, std::size_t n, sky_direction const &direction,
+                       observatory_position const &observatory, tdb_clock::time_point *out,
+                       std::chrono::nanoseconds cache_span) {
+    arrival_times(in, n, target(direction, observatory, center::barycenter, true), out, cache_span);
+}
+
+void heliocentric_times(tt_clock::time_point const *in, std::size_t n, sky_direction const &direction,
+                        observatory_position const &observatory, tt_clock::time_point *out,
+                        std::chrono::nanoseconds cache_span) {
+    arrival_times(in, n, target(direction, observatory, center::sun, false), out, cache_span);
+}
+
+void heliocentric_times(utc_clock::time_point const *in, std::size_t n, sky_direction const &direction,
+                        observatory_position const &observatory, utc_clock::time_point *out,
+                        std::chrono::nanoseconds cache_span) {
+    arrival_times(in, n, target(direction, observatory, center::sun, false), out, cache_span);
+}
+
+}  // namespace astrochrono
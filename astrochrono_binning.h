@@ -0,0 +1,349 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+#ifndef ASTROCHRONO_BINNING_H
+#define ASTROCHRONO_BINNING_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "astrochrono.h"
+
+namespace astrochrono {
+
+namespace detail {
+
+// Smallest number of events worth starting a thread for
+constexpr std::size_t min_binning_chunk = std::size_t{1} << 16;
+
+// Double of x < 2^32, through the 2^52 exponent bias rather than an int64 -> double instruction
+inline double uint32_to_double(std::uint64_t x) noexcept {
+    std::uint64_t const bits = x | 0x4330000000000000;
+    double d;
+    std::memcpy(&d, &bits, sizeof(d));
+    return d - 4503599627370496.0;
+}
+
+// Nearest integer to 0 <= x < 2^51, through the 2^52 exponent bias
+inline std::uint64_t small_double_to_uint(double x) noexcept {
+    double const biased = x + 4503599627370496.0;
+    std::uint64_t bits;
+    std::memcpy(&bits, &biased, sizeof(bits));
+    return bits & ((std::uint64_t{1} << 52) - 1);
+}
+
+// Nanosecond counts of in[0, n), already on the time scale of the bins
+template <typename Clock, typename TimePoint>
+void clock_nsecs(TimePoint const *in, std::size_t n, std::int64_t *out, std::true_type) noexcept {
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = in[i].time_since_epoch().count();
+    }
+}
+
+// Nanosecond counts of in[0, n) converted to Clock
+template <typename Clock, typename TimePoint>
+void clock_nsecs(TimePoint const *in, std::size_t n, std::int64_t *out, std::false_type) {
+    typename Clock::time_point converted[256];
+    for (std::size_t i = 0; i < n; i += 256) {
+        std::size_t const m = std::min<std::size_t>(256, n - i);
+        timescale_cast<Clock>(in + i, m, converted);
+        clock_nsecs<Clock>(converted, m, out + i, std::true_type{});
+    }
+}
+
+template <typename Clock, typename TimePoint>
+void clock_nsecs(TimePoint const *in, std::size_t n, std::int64_t *out) {
+    clock_nsecs<Clock>(in, n, out, std::is_same<TimePoint, typename Clock::time_point>{});
+}
+
+}  // namespace detail
+
+/* Grid of time bins [lower(i), upper(i)) on the time scale of Clock, for light curves and
+ * histograms of event times.
+ *
+ * The bin edges are integer nanoseconds, computed once, so events are binned without floating
+ * point day numbers. A uniform grid assigns bins arithmetically, with a floating point estimate
+ * of the quotient corrected in integers, which makes it exact. Events on another time scale are
+ * converted to Clock a block at a time. Sorted runs of events are binned with a merge walk over
+ * the edges, which only searches for the first event of each bin. An MJD aligned grid starts at
+ * Clock::from_mjd of a whole or exactly representable day number.
+ */
+template <typename Clock>
+class time_bins {
+public:
+    using clock = Clock;
+    using time_point = typename Clock::time_point;
+    using index_type = std::int32_t;
+
+    // Index of events outside the grid
+    static constexpr index_type outside = -1;
+
+    // count bins of the given width, the first starting at origin
+    time_bins(time_point origin, std::chrono::nanoseconds width, std::size_t count)
+            : origin_(origin.time_since_epoch().count()), width_(width.count()), uniform_(true) {
+        if (width_ <= 0 || count == 0 || count > static_cast<std::size_t>(std::numeric_limits<index_type>::max())) {
+            throw std::invalid_argument("Bins need a positive width and count");
+        }
+        if (static_cast<std::uint64_t>(width_) > std::numeric_limits<std::int64_t>::max() / count ||
+            origin_ > std::numeric_limits<std::int64_t>::max() - width_ * static_cast<std::int64_t>(count)) {
+            throw std::out_of_range("Bins extend beyond the range of time_point");
+        }
+        inverse_width_ = 1.0 / static_cast<double>(width_);
+        edges_.resize(count + 1);
+        for (std::size_t i = 0; i <= count; ++i) {
+            edges_[i] = origin_ + width_ * static_cast<std::int64_t>(i);
+        }
+    }
+
+    // Bins between consecutive edges, which must increase
+    explicit time_bins(std::vector<time_point> const &edges) : uniform_(false) {
+        if (edges.size() < 2 || edges.size() - 1 > static_cast<std::size_t>(std::numeric_limits<index_type>::max())) {
+            throw std::invalid_argument("Bins need at least two edges");
+        }
+        edges_.resize(edges.size());
+        for (std::size_t i = 0; i < edges.size(); ++i) {
+            edges_[i] = edges[i].time_since_epoch().count();
+            if (i > 0 && edges_[i] <= edges_[i - 1]) {
+                throw std::invalid_argument("Bin edges must increase");
+            }
+        }
+        origin_ = edges_.front();
+    }
+
+    std::size_t size() const noexcept { return edges_.size() - 1; }
+
+    bool is_uniform() const noexcept { return uniform_; }
+
+    time_point lower(std::size_t i) const { return time_point{std::chrono::nanoseconds{edges_[i]}}; }
+
+    time_point upper(std::size_t i) const { return time_point{std::chrono::nanoseconds{edges_[i + 1]}}; }
+
+    // Nanosecond counts of the size() + 1 edges
+    std::vector<std::int64_t> const &edges() const noexcept { return edges_; }
+
+    template <typename TimePoint>
+    index_type find(TimePoint const &tp) const {
+        std::int64_t const t = timescale_cast<Clock>(tp).time_since_epoch().count();
+        index_type i;
+        bin(&t, 1, &i);
+        return i;
+    }
+
+    // Bin index of each event, or outside
+    template <typename TimePoint>
+    void assign(TimePoint const *in, std::size_t n, index_type *out) const {
+        std::int64_t t[block_size];
+        for (std::size_t i = 0; i < n; i += block_size) {
+            std::size_t const m = std::min(block_size, n - i);
+            detail::clock_nsecs<Clock>(in + i, m, t);
+            bin(t, m, out + i);
+        }
+    }
+
+    // Add the number of events in each bin to counts[0, size()), returns the number of events
+    // outside the grid. Large inputs are split over threads (by default one per hardware thread)
+    // that fill partial histograms, which are then summed by bin ranges in parallel.
+    template <typename TimePoint>
+    std::size_t histogram(TimePoint const *in, std::size_t n, std::uint64_t *counts, unsigned threads = 0) const {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        std::size_t const bins = size();
+        std::size_t const chunks =
+                std::max<std::size_t>(1, std::min<std::size_t>(threads, n / detail::min_binning_chunk));
+        std::size_t const chunk = (n + chunks - 1) / chunks;
+        // one slot past the bins per partial histogram for the events outside
+        std::vector<std::uint64_t> partial(chunks * (bins + 1));
+        run_parallel(chunks, [&](std::size_t c) {
+            std::size_t const first = std::min(n, c * chunk);
+            std::size_t const last = std::min(n, first + chunk);
+            count(in + first, last - first, partial.data() + c * (bins + 1));
+        });
+        std::size_t const slice = (bins + 1 + chunks - 1) / chunks;
+        run_parallel(chunks, [&](std::size_t c) {
+            std::size_t const first = std::min(bins + 1, c * slice);
+            std::size_t const last = std::min(bins + 1, first + slice);
+            for (std::size_t p = 1; p < chunks; ++p) {
+                std::uint64_t const *from = partial.data() + p * (bins + 1);
+                for (std::size_t b = first; b < last; ++b) {
+                    partial[b] += from[b];
+                }
+            }
+        });
+        for (std::size_t b = 0; b < bins; ++b) {
+            counts[b] += partial[b];
+        }
+        return static_cast<std::size_t>(partial[bins]);
+    }
+
+    template <typename TimePoint>
+    std::vector<std::uint64_t> histogram(TimePoint const *in, std::size_t n, unsigned threads = 0) const {
+        std::vector<std::uint64_t> counts(size());
+        histogram(in, n, counts.data(), threads);
+        return counts;
+    }
+
+private:
+    // Number of events binned at once
+    static constexpr std::size_t block_size = 256;
+
+    // Call f(c) for c in [0, chunks), on a thread each but the first. Exceptions are caught on
+    // the thread that threw them and the first one by chunk is rethrown once all threads are joined.
+    template <typename F>
+    static void run_parallel(std::size_t chunks, F f) {
+        std::vector<std::exception_ptr> errors(chunks);
+        auto const call = [&f, &errors](std::size_t c) {
+            try {
+                f(c);
+            } catch (...) {
+                errors[c] = std::current_exception();
+            }
+        };
+        std::vector<std::thread> workers;
+        try {
+            for (std::size_t c = 1; c < chunks; ++c) {
+                workers.emplace_back([&call, c] { call(c); });
+            }
+        } catch (...) {
+            for (auto &worker : workers) {
+                worker.join();
+            }
+            throw;
+        }
+        call(0);
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        for (auto const &error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+    // Add the events of in[0, n) to counts[0, size()], the last for those outside
+    template <typename TimePoint>
+    void count(TimePoint const *in, std::size_t n, std::uint64_t *counts) const {
+        std::int64_t t[block_size];
+        index_type index[block_size];
+        std::size_t const bins = size();
+        for (std::size_t i = 0; i < n; i += block_size) {
+            std::size_t const m = std::min(block_size, n - i);
+            detail::clock_nsecs<Clock>(in + i, m, t);
+            if (std::is_sorted(t, t + m)) {
+                walk(t, m, [&](std::size_t first, std::size_t last, index_type b) {
+                    counts[b == outside ? bins : static_cast<std::size_t>(b)] += last - first;
+                });
+            } else {
+                bin_unsorted(t, m, index);
+                for (std::size_t j = 0; j < m; ++j) {
+                    ++counts[index[j] == outside ? bins : static_cast<std::size_t>(index[j])];
+                }
+            }
+        }
+    }
+
+    // Bin indices of the nanosecond counts t[0, m)
+    void bin(std::int64_t const *t, std::size_t m, index_type *out) const {
+        if (m > 1 && std::is_sorted(t, t + m)) {
+            walk(t, m, [&](std::size_t first, std::size_t last, index_type b) { std::fill(out + first, out + last, b); });
+        } else {
+            bin_unsorted(t, m, out);
+        }
+    }
+
+    void bin_unsorted(std::int64_t const *t, std::size_t m, index_type *out) const {
+        if (uniform_) {
+            // Offsets wrap around as unsigned, so a single compare finds the events outside. The
+            // quotient is estimated with a double reciprocal and corrected by one either way; the
+            // compare and both conversions are done with 64-bit add, shift and logic operations
+            // (the conversions through the 2^52 exponent bias), so the loop vectorizes with SSE2
+            // and AVX2 as well as AVX-512.
+            std::uint64_t const origin = static_cast<std::uint64_t>(origin_);
+            std::uint64_t const span = static_cast<std::uint64_t>(edges_.back() - origin_);
+            std::uint64_t const width = static_cast<std::uint64_t>(width_);
+            double const inverse_width = inverse_width_;
+            for (std::size_t j = 0; j < m; ++j) {
+                std::uint64_t const d = static_cast<std::uint64_t>(t[j]) - origin;
+                // all ones for d < span, from the borrow of d - span
+                std::uint64_t const inside = 0 - (((~d & span) | ((~d | span) & (d - span))) >> 63);
+                std::uint64_t const e = d & inside;
+                double const estimate = (detail::uint32_to_double(e >> 32) * 4294967296.0 +
+                                         detail::uint32_to_double(e & 0xffffffff)) *
+                                        inverse_width;
+                std::uint64_t q = detail::small_double_to_uint(estimate);
+                // the rounded estimate is within one of the quotient for any index that fits index_type
+                std::uint64_t const r = e - q * width;
+                std::uint64_t const negative = r >> 63;
+                q = q - negative + ((((r - width) >> 63) ^ 1) & (negative ^ 1));
+                out[j] = static_cast<index_type>((q & inside) | ~inside);
+            }
+        } else {
+            for (std::size_t j = 0; j < m; ++j) {
+                out[j] = index_of(t[j]);
+            }
+        }
+    }
+
+    index_type index_of(std::int64_t t) const {
+        std::size_t const upper = std::upper_bound(edges_.begin(), edges_.end(), t) - edges_.begin();
+        return upper == 0 || upper == edges_.size() ? outside : static_cast<index_type>(upper - 1);
+    }
+
+    // Call f(first, last, bin) for consecutive runs [first, last) of the sorted t[0, m) in one bin
+    template <typename F>
+    void walk(std::int64_t const *t, std::size_t m, F f) const {
+        std::size_t p = 0;
+        while (p < m) {
+            std::size_t const upper = std::upper_bound(edges_.begin(), edges_.end(), t[p]) - edges_.begin();
+            std::size_t const q = upper < edges_.size() ? std::lower_bound(t + p, t + m, edges_[upper]) - t : m;
+            f(p, q, upper == 0 || upper == edges_.size() ? outside : static_cast<index_type>(upper - 1));
+            p = q;
+        }
+    }
+
+    std::vector<std::int64_t> edges_;
+    std::int64_t origin_;
+    std::int64_t width_ = 0;
+    double inverse_width_ = 0;
+    bool uniform_;
+};
+
+template <typename Clock>
+constexpr typename time_bins<Clock>::index_type time_bins<Clock>::outside;
+
+template <typename Clock>
+constexpr std::size_t time_bins<Clock>::block_size;
+
+}  // namespace astrochrono
+
+#endif  // ASTROCHRONO_BINNING_H
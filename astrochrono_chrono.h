@@ -0,0 +1,292 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+#ifndef ASTROCHRONO_CHRONO_H
+#define ASTROCHRONO_CHRONO_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "astrochrono.h"
+#include "astrochrono_leap.h"
+
+namespace astrochrono {
+
+/* Conversions to and from std::chrono clocks.
+ *
+ * utc_clock counts like std::chrono::system_clock, Unix time in nanoseconds since 1970-01-01
+ * without leap seconds, so converting between the two only reinterprets the count. TAI and TT go
+ * through the leap second table with timescale_cast.
+ *
+ * With C++20 std::chrono::clock_time_conversion is specialized as well, so std::chrono::clock_cast
+ * converts between these clocks and the std::chrono clocks. tai_clock and tt_clock convert to
+ * std::chrono::utc_clock and std::chrono::tai_clock by constant offsets, for which std::chrono
+ * assumes TAI - UTC = 10 s before 1972 where timescale_cast follows the drift terms.
+ */
+
+namespace detail {
+
+// Whether system_clock time points have the layout of the astrochrono ones
+constexpr bool sys_is_nanoseconds = std::is_same<std::chrono::system_clock::duration, std::chrono::nanoseconds>::value;
+
+// Time points converted at once by the array conversions
+constexpr std::size_t chrono_block_size = 1024;
+
+// Copy n time points that count the same nanoseconds from one clock to another
+template <typename InTimePoint, typename OutTimePoint>
+void reinterpret_time_points(InTimePoint const *in, std::size_t n, OutTimePoint *out) noexcept {
+    static_assert(sizeof(InTimePoint) == sizeof(OutTimePoint) && std::is_trivially_copyable<InTimePoint>::value &&
+                          std::is_trivially_copyable<OutTimePoint>::value,
+                  "Time points must have the same representation");
+    if (n != 0) {
+        // time_point is trivially copyable but has a default constructor, copy as bytes
+        std::memcpy(static_cast<void *>(out), static_cast<void const *>(in), n * sizeof(OutTimePoint));
+    }
+}
+
+// UTC time points of in[0, n), in itself or converted into buffer
+inline utc_clock::time_point const *utc_block(utc_clock::time_point const *in, std::size_t, utc_clock::time_point *) {
+    return in;
+}
+
+template <typename TimePoint>
+utc_clock::time_point const *utc_block(TimePoint const *in, std::size_t n, utc_clock::time_point *buffer) {
+    timescale_cast<utc_clock>(in, n, buffer);
+    return buffer;
+}
+
+}  // namespace detail
+
+template <typename TimePoint>
+std::chrono::system_clock::time_point to_sys(TimePoint const &tp) {
+    auto const utc = timescale_cast<utc_clock>(tp).time_since_epoch();
+    return std::chrono::system_clock::time_point{
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(utc)};
+}
+
+template <typename Clock>
+typename Clock::time_point from_sys(std::chrono::system_clock::time_point const &tp) {
+    utc_clock::time_point const utc{std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch())};
+    return timescale_cast<Clock>(utc);
+}
+
+// Array conversions, UTC is copied as is and TAI and TT are converted a block at a time with the
+// array timescale_cast
+template <typename TimePoint>
+void to_sys(TimePoint const *in, std::size_t n, std::chrono::system_clock::time_point *out) {
+    utc_clock::time_point utc[detail::chrono_block_size];
+    for (std::size_t i = 0; i < n; i += detail::chrono_block_size) {
+        std::size_t const m = std::min(detail::chrono_block_size, n - i);
+        utc_clock::time_point const *block = detail::utc_block(in + i, m, utc);
+        if (detail::sys_is_nanoseconds) {
+            detail::reinterpret_time_points(block, m, out + i);
+        } else {
+            for (std::size_t j = 0; j < m; ++j) {
+                out[i + j] = std::chrono::system_clock::time_point{
+                        std::chrono::duration_cast<std::chrono::system_clock::duration>(block[j].time_since_epoch())};
+            }
+        }
+    }
+}
+
+template <typename Clock>
+void from_sys(std::chrono::system_clock::time_point const *in, std::size_t n, typename Clock::time_point *out) {
+    utc_clock::time_point utc[detail::chrono_block_size];
+    for (std::size_t i = 0; i < n; i += detail::chrono_block_size) {
+        std::size_t const m = std::min(detail::chrono_block_size, n - i);
+        if (detail::sys_is_nanoseconds) {
+            detail::reinterpret_time_points(in + i, m, utc);
+        } else {
+            for (std::size_t j = 0; j < m; ++j) {
+                utc[j] = utc_clock::time_point{
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(in[i + j].time_since_epoch())};
+            }
+        }
+        timescale_cast<Clock>(utc, m, out + i);
+    }
+}
+
+}  // namespace astrochrono
+
+#if defined(__cpp_lib_chrono) && __cpp_lib_chrono >= 201907L
+
+namespace astrochrono {
+
+namespace detail {
+
+// Offset added to the count of a SourceClock time point for DestClock, for the clock pairs whose
+// conversion is a constant offset
+template <typename DestClock, typename SourceClock>
+struct chrono_offset;
+
+// Seconds from 1958-01-01, the epoch of std::chrono::tai_clock, to 1970-01-01
+constexpr std::chrono::nanoseconds STD_TAI_EPOCH_OFFSET = std::chrono::seconds{378691200};
+// TAI - UTC of std::chrono::utc_clock before the first leap second in 1972
+constexpr std::chrono::nanoseconds STD_TAI_MINUS_UTC = std::chrono::seconds{10};
+constexpr std::chrono::nanoseconds TT_MINUS_TAI_DURATION = std::chrono::nanoseconds{TT_MINUS_TAI_NS};
+
+template <>
+struct chrono_offset<std::chrono::system_clock, utc_clock> {
+    static constexpr std::chrono::nanoseconds value = std::chrono::nanoseconds{0};
+};
+
+template <>
+struct chrono_offset<utc_clock, std::chrono::system_clock> {
+    static constexpr std::chrono::nanoseconds value = std::chrono::nanoseconds{0};
+};
+
+template <>
+struct chrono_offset<std::chrono::utc_clock, tai_clock> {
+    static constexpr std::chrono::nanoseconds value = -STD_TAI_MINUS_UTC;
+};
+
+template <>
+struct chrono_offset<tai_clock, std::chrono::utc_clock> {
+    static constexpr std::chrono::nanoseconds value = STD_TAI_MINUS_UTC;
+};
+
+template <>
+struct chrono_offset<std::chrono::tai_clock, tai_clock> {
+    static constexpr std::chrono::nanoseconds value = STD_TAI_EPOCH_OFFSET;
+};
+
+template <>
+struct chrono_offset<tai_clock, std::chrono::tai_clock> {
+    static constexpr std::chrono::nanoseconds value = -STD_TAI_EPOCH_OFFSET;
+};
+
+template <>
+struct chrono_offset<std::chrono::utc_clock, tt_clock> {
+    static constexpr std::chrono::nanoseconds value = -STD_TAI_MINUS_UTC - TT_MINUS_TAI_DURATION;
+};
+
+template <>
+struct chrono_offset<tt_clock, std::chrono::utc_clock> {
+    static constexpr std::chrono::nanoseconds value = STD_TAI_MINUS_UTC + TT_MINUS_TAI_DURATION;
+};
+
+template <>
+struct chrono_offset<std::chrono::tai_clock, tt_clock> {
+    static constexpr std::chrono::nanoseconds value = STD_TAI_EPOCH_OFFSET - TT_MINUS_TAI_DURATION;
+};
+
+template <>
+struct chrono_offset<tt_clock, std::chrono::tai_clock> {
+    static constexpr std::chrono::nanoseconds value = TT_MINUS_TAI_DURATION - STD_TAI_EPOCH_OFFSET;
+};
+
+template <typename DestClock, typename SourceClock>
+concept constant_chrono_offset = requires { chrono_offset<DestClock, SourceClock>::value; };
+
+template <typename DestClock, typename SourceClock>
+struct chrono_conversion {
+    template <typename Duration>
+    auto operator()(std::chrono::time_point<SourceClock, Duration> const &t) const {
+        using duration = std::common_type_t<Duration, std::chrono::nanoseconds>;
+        return std::chrono::time_point<DestClock, duration>{t.time_since_epoch() +
+                                                            chrono_offset<DestClock, SourceClock>::value};
+    }
+};
+
+}  // namespace detail
+
+// Convert n time points between clocks with std::chrono::clock_cast. Between a clock of this
+// library and std::chrono::system_clock, utc_clock or tai_clock with a constant offset the
+// conversion is a single offset add over the array, or a copy where the offset is zero.
+template <typename DestClock, typename SourceClock, typename SourceDuration, typename DestDuration>
+void clock_cast(std::chrono::time_point<SourceClock, SourceDuration> const *in, std::size_t n,
+                std::chrono::time_point<DestClock, DestDuration> *out) {
+    if constexpr (detail::constant_chrono_offset<DestClock, SourceClock> &&
+                  std::is_same_v<SourceDuration, std::chrono::nanoseconds> &&
+                  std::is_same_v<DestDuration, std::chrono::nanoseconds>) {
+        constexpr std::int64_t offset = detail::chrono_offset<DestClock, SourceClock>::value.count();
+        if constexpr (offset == 0) {
+            detail::reinterpret_time_points(in, n, out);
+        } else {
+            for (std::size_t i = 0; i < n; ++i) {
+                out[i] = std::chrono::time_point<DestClock, DestDuration>{
+                        std::chrono::nanoseconds{in[i].time_since_epoch().count() + offset}};
+            }
+        }
+    } else {
+        for (std::size_t i = 0; i < n; ++i) {
+            out[i] = std::chrono::time_point_cast<DestDuration>(std::chrono::clock_cast<DestClock>(in[i]));
+        }
+    }
+}
+
+}  // namespace astrochrono
+
+namespace std {
+namespace chrono {
+
+template <>
+struct clock_time_conversion<system_clock, astrochrono::utc_clock>
+        : astrochrono::detail::chrono_conversion<system_clock, astrochrono::utc_clock> {};
+
+template <>
+struct clock_time_conversion<astrochrono::utc_clock, system_clock>
+        : astrochrono::detail::chrono_conversion<astrochrono::utc_clock, system_clock> {};
+
+template <>
+struct clock_time_conversion<utc_clock, astrochrono::tai_clock>
+        : astrochrono::detail::chrono_conversion<utc_clock, astrochrono::tai_clock> {};
+
+template <>
+struct clock_time_conversion<astrochrono::tai_clock, utc_clock>
+        : astrochrono::detail::chrono_conversion<astrochrono::tai_clock, utc_clock> {};
+
+template <>
+struct clock_time_conversion<tai_clock, astrochrono::tai_clock>
+        : astrochrono::detail::chrono_conversion<tai_clock, astrochrono::tai_clock> {};
+
+template <>
+struct clock_time_conversion<astrochrono::tai_clock, tai_clock>
+        : astrochrono::detail::chrono_conversion<astrochrono::tai_clock, tai_clock> {};
+
+template <>
+struct clock_time_conversion<utc_clock, astrochrono::tt_clock>
+        : astrochrono::detail::chrono_conversion<utc_clock, astrochrono::tt_clock> {};
+
+template <>
+struct clock_time_conversion<astrochrono::tt_clock, utc_clock>
+        : astrochrono::detail::chrono_conversion<astrochrono::tt_clock, utc_clock> {};
+
+template <>
+struct clock_time_conversion<tai_clock, astrochrono::tt_clock>
+        : astrochrono::detail::chrono_conversion<tai_clock, astrochrono::tt_clock> {};
+
+template <>
+struct clock_time_conversion<astrochrono::tt_clock, tai_clock>
+        : astrochrono::detail::chrono_conversion<astrochrono::tt_clock, tai_clock> {};
+
+}  // namespace chrono
+}  // namespace std
+
+#endif  // __cpp_lib_chrono >= 201907L
+
+#endif  // ASTROCHRONO_CHRONO_H
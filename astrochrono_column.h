@@ -0,0 +1,132 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef ASTROCHRONO_COLUMN_H
+#define ASTROCHRONO_COLUMN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "astrochrono.h"
+#include "astrochrono_format.h"
+
+namespace astrochrono {
+
+/* Column of strings in one contiguous buffer, laid out like an Arrow (large) string array:
+ * string i is data[offsets[i], offsets[i + 1]).
+ */
+struct string_column {
+    std::vector<char> data;
+    std::vector<std::int64_t> offsets = std::vector<std::int64_t>(1, 0);
+
+    std::size_t size() const noexcept { return offsets.size() - 1; }
+
+    bool empty() const noexcept { return offsets.size() == 1; }
+
+    char const *begin(std::size_t i) const noexcept { return data.data() + offsets[i]; }
+
+    char const *end(std::size_t i) const noexcept { return data.data() + offsets[i + 1]; }
+
+    std::string operator[](std::size_t i) const { return std::string(begin(i), end(i)); }
+
+    void clear() noexcept {
+        data.clear();
+        offsets.assign(1, 0);
+    }
+};
+
+namespace detail {
+
+// Smallest number of time points worth starting a thread for
+static constexpr std::size_t min_format_chunk = std::size_t{1} << 16;
+
+// Format in[first, last) into consecutive fields of width characters starting at out
+template <typename Pattern, typename TimePoint>
+void format_fixed_width(TimePoint const *in, std::size_t first, std::size_t last, std::size_t width,
+                        char *out, std::int64_t *offsets, std::int64_t base) noexcept {
+    for (std::size_t i = first; i < last; ++i) {
+        time_format<Pattern>::format_to(out + i * width, in[i]);
+        offsets[i] = base + static_cast<std::int64_t>((i + 1) * width);
+    }
+}
+
+}  // namespace detail
+
+/* Append the formatted time points in[0, n) to out.
+ *
+ * With the default pattern the strings are identical to those of to_string. As the pattern has a
+ * fixed width every string lands at a known position, so large inputs are split over threads
+ * (by default one per hardware thread) that write straight into the column.
+ */
+template <typename Pattern = patterns::iso8601, typename TimePoint>
+void format_column(TimePoint const *in, std::size_t n, string_column &out, unsigned threads = 0) {
+    static_assert(time_format<Pattern>::is_fixed_width, "format_column needs a fixed width pattern");
+    std::size_t const width = time_format<Pattern>::template fixed_size<typename TimePoint::clock>();
+    std::size_t const first = out.size();
+    std::int64_t const base = out.offsets.back();
+    out.data.resize(out.data.size() + n * width);
+    out.offsets.resize(out.offsets.size() + n);
+    char *data = out.data.data() + base;
+    std::int64_t *offsets = out.offsets.data() + first + 1;
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::size_t const chunks =
+            std::max<std::size_t>(1, std::min<std::size_t>(threads, n / detail::min_format_chunk));
+    std::size_t const chunk = (n + chunks - 1) / chunks;
+    std::vector<std::thread> workers;
+    try {
+        for (std::size_t c = 1; c < chunks; ++c) {
+            std::size_t const last = std::min(n, (c + 1) * chunk);
+            workers.emplace_back([=] {
+                detail::format_fixed_width<Pattern>(in, c * chunk, last, width, data, offsets, base);
+            });
+        }
+    } catch (...) {
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        out.data.resize(static_cast<std::size_t>(base));
+        out.offsets.resize(first + 1);
+        throw;
+    }
+    detail::format_fixed_width<Pattern>(in, 0, std::min(n, chunk), width, data, offsets, base);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+template <typename Pattern = patterns::iso8601, typename TimePoint>
+string_column format_column(TimePoint const *in, std::size_t n, unsigned threads = 0) {
+    string_column column;
+    format_column<Pattern>(in, n, column, threads);
+    return column;
+}
+
+}  // namespace astrochrono
+
+#endif  // ASTROCHRONO_COLUMN_H
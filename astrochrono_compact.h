@@ -0,0 +1,272 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef ASTROCHRONO_COMPACT_H
+#define ASTROCHRONO_COMPACT_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "astrochrono.h"
+
+namespace astrochrono {
+
+/* Column of time points stored as 32-bit offsets from a per-block base time point.
+ *
+ * Time points are truncated to Resolution relative to their block base, the base itself is the
+ * earliest time point of the block rounded down to a multiple of Resolution. A new block is started
+ * whenever the next time point would not fit in 32 bits at Resolution (about 71 minutes for the
+ * default microsecond resolution), so sorted or clustered input compresses to close to 4 bytes
+ * per time point.
+ */
+template <typename Clock, typename Resolution = std::chrono::microseconds>
+class compact_time_column {
+public:
+    using clock = Clock;
+    using time_point = typename Clock::time_point;
+    using resolution = Resolution;
+    using offset_type = std::uint32_t;
+
+    static_assert(std::is_integral<typename Resolution::rep>::value, "Resolution must have an integral count");
+
+    // Resolution in nanoseconds
+    static constexpr std::int64_t ticks =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Resolution{1}).count();
+    static_assert(ticks >= 1, "Resolution must not be finer than a nanosecond");
+
+    static constexpr std::size_t max_block_size = std::size_t{1} << 16;
+
+    struct block {
+        time_point base;         // time point of offset 0
+        std::size_t first;       // index of the first time point of the block
+        offset_type max_offset;  // largest offset in the block
+    };
+
+    compact_time_column() = default;
+
+    compact_time_column(time_point const *in, std::size_t n) { append(in, n); }
+
+    // Narrow n time points and append them, starting a new block
+    void append(time_point const *in, std::size_t n) {
+        std::size_t i = 0;
+        while (i < n) {
+            std::int64_t base;
+            std::int64_t hi;
+            std::size_t const j = block_end(in, i, std::min(n, i + max_block_size), base, hi);
+            std::size_t const first = offsets_.size();
+            offsets_.resize(first + (j - i));
+            narrow(in + i, j - i, base, offsets_.data() + first);
+            blocks_.push_back(block{time_point{std::chrono::nanoseconds{base}}, first,
+                                    static_cast<offset_type>(span(base, hi))});
+            i = j;
+        }
+    }
+
+    // Append n offsets relative to base as a new block
+    void append_block(time_point base, offset_type const *offsets, std::size_t n) {
+        if (n == 0) {
+            return;
+        }
+        std::size_t const first = offsets_.size();
+        offsets_.insert(offsets_.end(), offsets, offsets + n);
+        blocks_.push_back(block{base, first, *std::max_element(offsets, offsets + n)});
+    }
+
+    // Widen all time points into out[0, size())
+    void widen(time_point *out) const {
+        for (std::size_t b = 0; b < blocks_.size(); ++b) {
+            widen_block(b, out + blocks_[b].first);
+        }
+    }
+
+    // Widen the time points of block b into out[0, block_size(b))
+    void widen_block(std::size_t b, time_point *out) const {
+        std::int64_t const base = blocks_[b].base.time_since_epoch().count();
+        offset_type const *offsets = offsets_.data() + blocks_[b].first;
+        std::size_t const n = block_size(b);
+        for (std::size_t k = 0; k < n; ++k) {
+            std::int64_t const t = base + static_cast<std::int64_t>(offsets[k]) * ticks;
+            out[k] = time_point{std::chrono::nanoseconds{t}};
+        }
+    }
+
+    time_point operator[](std::size_t i) const {
+        auto it = std::upper_bound(blocks_.begin(), blocks_.end(), i,
+                                   [](std::size_t index, block const &b) { return index < b.first; });
+        --it;
+        return it->base + std::chrono::nanoseconds{static_cast<std::int64_t>(offsets_[i]) * ticks};
+    }
+
+    std::size_t size() const noexcept { return offsets_.size(); }
+
+    bool empty() const noexcept { return offsets_.empty(); }
+
+    std::vector<block> const &blocks() const noexcept { return blocks_; }
+
+    std::size_t block_size(std::size_t b) const noexcept {
+        return (b + 1 < blocks_.size() ? blocks_[b + 1].first : offsets_.size()) - blocks_[b].first;
+    }
+
+    offset_type const *offsets() const noexcept { return offsets_.data(); }
+
+    void reserve(std::size_t n) { offsets_.reserve(n); }
+
+    void clear() noexcept {
+        blocks_.clear();
+        offsets_.clear();
+    }
+
+private:
+    // Largest distance in nanoseconds from a block base that narrows to an offset_type
+    static constexpr std::uint64_t max_span_nsecs =
+            static_cast<std::uint64_t>(ticks) > std::numeric_limits<std::uint64_t>::max() >> 32
+                    ? std::numeric_limits<std::uint64_t>::max()
+                    : (std::uint64_t{std::numeric_limits<offset_type>::max()} + 1) * ticks - 1;
+
+    // Number of resolution ticks from base to t, for t >= base
+    static std::uint64_t span(std::int64_t base, std::int64_t t) noexcept {
+        return (static_cast<std::uint64_t>(t) - static_cast<std::uint64_t>(base)) / ticks;
+    }
+
+    static std::int64_t base_of(std::int64_t t) noexcept {
+        // keep the earliest representable time points unaligned rather than overflow
+        return t < std::numeric_limits<std::int64_t>::min() + ticks ? t : detail::floor_div(t, ticks) * ticks;
+    }
+
+    // End of the block starting at in[first] and at most last, with its base and latest time.
+    // Only compares nanoseconds, the base is realigned when an earlier time point shows up.
+    static std::size_t block_end(time_point const *in, std::size_t first, std::size_t last, std::int64_t &base,
+                                 std::int64_t &hi) noexcept {
+        std::int64_t lo = in[first].time_since_epoch().count();
+        hi = lo;
+        base = base_of(lo);
+        std::size_t j = first + 1;
+        for (; j < last; ++j) {
+            std::int64_t const t = in[j].time_since_epoch().count();
+            if (t < lo) {
+                std::int64_t const new_base = base_of(t);
+                if (static_cast<std::uint64_t>(hi) - static_cast<std::uint64_t>(new_base) > max_span_nsecs) {
+                    break;
+                }
+                lo = t;
+                base = new_base;
+            } else if (t > hi) {
+                if (static_cast<std::uint64_t>(t) - static_cast<std::uint64_t>(base) > max_span_nsecs) {
+                    break;
+                }
+                hi = t;
+            }
+        }
+        return j;
+    }
+
+    // Offsets of in[0, n) from base, all within max_span_nsecs.
+    // The quotient is estimated with a double reciprocal and corrected by one tick either way.
+    // Both conversions go through the 2^52 exponent bias instead of int64 <-> double instructions,
+    // so only 64-bit add, shift and multiply are needed and the loop vectorizes with SSE2 or AVX2.
+    static void narrow(time_point const *in, std::size_t n, std::int64_t base, offset_type *out) noexcept {
+        constexpr std::uint64_t bias_bits = 0x4330000000000000;  // 2^52
+        constexpr std::uint64_t mantissa = (std::uint64_t{1} << 52) - 1;
+        constexpr double bias = 4503599627370496.0;
+        constexpr double inverse = 1.0 / static_cast<double>(ticks);
+        constexpr std::uint64_t width = static_cast<std::uint64_t>(ticks);
+        std::uint64_t const b = static_cast<std::uint64_t>(base);
+        for (std::size_t k = 0; k < n; ++k) {
+            std::uint64_t const d = static_cast<std::uint64_t>(in[k].time_since_epoch().count()) - b;
+            double const hi = bits_to_double((d >> 32) | bias_bits) - bias;
+            double const lo = bits_to_double((d & 0xffffffff) | bias_bits) - bias;
+            double const estimate = (hi * 4294967296.0 + lo) * inverse;
+            std::uint64_t q = double_to_bits(estimate + bias) & mantissa;
+            std::uint64_t const r = d - q * width;
+            // r is in [-width, 2 * width) modulo 2^64
+            q = q - (r >> 63) + (((r - width) >> 63) ^ 1);
+            out[k] = static_cast<offset_type>(q);
+        }
+    }
+
+    static double bits_to_double(std::uint64_t bits) noexcept {
+        double x;
+        std::memcpy(&x, &bits, sizeof(x));
+        return x;
+    }
+
+    static std::uint64_t double_to_bits(double x) noexcept {
+        std::uint64_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        return bits;
+    }
+
+    std::vector<block> blocks_;
+    std::vector<offset_type> offsets_;
+};
+
+template <typename Clock, typename Resolution>
+constexpr std::int64_t compact_time_column<Clock, Resolution>::ticks;
+
+template <typename Clock, typename Resolution>
+constexpr std::size_t compact_time_column<Clock, Resolution>::max_block_size;
+
+template <typename Clock, typename Resolution>
+constexpr std::uint64_t compact_time_column<Clock, Resolution>::max_span_nsecs;
+
+// Convert a compact column to another time scale.
+// Blocks that lie within a single constant leap second segment, with an offset that is a whole
+// number of resolution ticks, are converted by shifting their base. The remaining blocks are
+// widened, converted and narrowed again, which truncates the converted time points to the resolution.
+template <typename ToClock, typename FromClock, typename Resolution>
+compact_time_column<ToClock, Resolution> timescale_cast(
+        compact_time_column<FromClock, Resolution> const &column) {
+    using from_column = compact_time_column<FromClock, Resolution>;
+    compact_time_column<ToClock, Resolution> result;
+    result.reserve(column.size());
+    std::vector<typename FromClock::time_point> from;
+    std::vector<typename ToClock::time_point> to;
+    auto const &blocks = column.blocks();
+    for (std::size_t b = 0; b < blocks.size(); ++b) {
+        auto const first = blocks[b].base;
+        auto const last = first + std::chrono::nanoseconds{static_cast<std::int64_t>(blocks[b].max_offset) *
+                                                           from_column::ticks};
+        auto const segment = find_timescale_segment<ToClock>(first);
+        std::size_t const n = column.block_size(b);
+        if (segment.is_constant && last <= segment.last && segment.offset.count() % from_column::ticks == 0) {
+            result.append_block(typename ToClock::time_point{first.time_since_epoch() + segment.offset},
+                                column.offsets() + blocks[b].first, n);
+        } else {
+            from.resize(n);
+            to.resize(n);
+            column.widen_block(b, from.data());
+            timescale_cast<ToClock>(from.data(), n, to.data());
+            result.append(to.data(), n);
+        }
+    }
+    return result;
+}
+
+}  // namespace astrochrono
+
+#endif  // ASTROCHRONO_COMPACT_H
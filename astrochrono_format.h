@@ -0,0 +1,671 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef ASTROCHRONO_FORMAT_H
+#define ASTROCHRONO_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "astrochrono.h"
+
+namespace astrochrono {
+
+/* Compile-time format patterns.
+ *
+ * A pattern is a type with a constexpr static member function pattern() returning the pattern string:
+ *
+ *     struct my_pattern { static constexpr const char* pattern() { return "%Y-%jT%H:%M:%S"; } };
+ *     auto s = time_format<my_pattern>::format(tp);
+ *     auto tp = time_format<my_pattern>::parse<tai_clock>(s);
+ *
+ * The pattern is parsed when time_format is instantiated, a malformed pattern is a compile error.
+ * Supported conversion specifiers:
+ *
+ *     %Y     year, 4 digits
+ *     %m     month, 2 digits
+ *     %d     day of month, 2 digits
+ *     %j     day of year, 3 digits
+ *     %H     hour, 2 digits
+ *     %M     minute, 2 digits
+ *     %S     second, 2 digits
+ *     %<n>f  first n (1-9, default 9) digits of the fractional second, truncated
+ *     %<n>Q  MJD with n (0-9, default 9) decimals, truncated
+ *     %<n>J  JD with n (0-9, default 9) decimals, truncated
+ *     %Z     "Z" for utc_clock, nothing for tai_clock and tt_clock
+ *     %%     literal "%"
+ *
+ * Any other character is copied (or matched when parsing) literally.
+ */
+namespace patterns {
+
+// Layout of to_string / from_string
+struct iso8601 {
+    static constexpr const char* pattern() { return "%Y-%m-%dT%H:%M:%S.%9f%Z"; }
+};
+
+struct iso8601_basic {
+    static constexpr const char* pattern() { return "%Y%m%dT%H%M%S.%9f%Z"; }
+};
+
+// FITS DATE-OBS keyword value (the time scale is given by the TIMESYS keyword)
+struct fits_date_obs {
+    static constexpr const char* pattern() { return "%Y-%m-%dT%H:%M:%S.%3f"; }
+};
+
+struct day_of_year {
+    static constexpr const char* pattern() { return "%Y-%jT%H:%M:%S"; }
+};
+
+}  // namespace patterns
+
+namespace detail {
+
+enum class field_kind {
+    literal,
+    year,
+    month,
+    day,
+    day_of_year,
+    hour,
+    minute,
+    second,
+    fraction,
+    mjd,
+    jd,
+    zone
+};
+
+struct format_field {
+    field_kind kind;
+    int width;
+    char ch;
+};
+
+// Parse the field starting at pattern[pos] and advance pos past it
+constexpr format_field next_format_field(const char* pattern, std::size_t& pos) {
+    if (pattern[pos] != '%') {
+        return format_field{field_kind::literal, 1, pattern[pos++]};
+    }
+    ++pos;
+    int width = -1;
+    if (pattern[pos] >= '0' && pattern[pos] <= '9') {
+        width = pattern[pos++] - '0';
+    }
+    char const spec = pattern[pos++];
+    if (width >= 0 && spec != 'f' && spec != 'Q' && spec != 'J') {
+        throw std::invalid_argument("Width only allowed for %f, %Q and %J");
+    }
+    switch (spec) {
+        case 'Y':
+            return format_field{field_kind::year, 4, spec};
+        case 'm':
+            return format_field{field_kind::month, 2, spec};
+        case 'd':
+            return format_field{field_kind::day, 2, spec};
+        case 'j':
+            return format_field{field_kind::day_of_year, 3, spec};
+        case 'H':
+            return format_field{field_kind::hour, 2, spec};
+        case 'M':
+            return format_field{field_kind::minute, 2, spec};
+        case 'S':
+            return format_field{field_kind::second, 2, spec};
+        case 'f':
+            if (width == 0) {
+                throw std::invalid_argument("Fractional seconds need at least one digit");
+            }
+            return format_field{field_kind::fraction, width < 0 ? 9 : width, spec};
+        case 'Q':
+            return format_field{field_kind::mjd, width < 0 ? 9 : width, spec};
+        case 'J':
+            return format_field{field_kind::jd, width < 0 ? 9 : width, spec};
+        case 'Z':
+            return format_field{field_kind::zone, 1, spec};
+        case '%':
+            return format_field{field_kind::literal, 1, '%'};
+        default:
+            throw std::invalid_argument("Unknown conversion specifier in format pattern");
+    }
+}
+
+constexpr std::size_t count_format_fields(const char* pattern) {
+    std::size_t pos = 0;
+    std::size_t n = 0;
+    while (pattern[pos] != '\0') {
+        next_format_field(pattern, pos);
+        ++n;
+    }
+    return n;
+}
+
+constexpr format_field format_field_at(const char* pattern, std::size_t index) {
+    std::size_t pos = 0;
+    format_field f = next_format_field(pattern, pos);
+    for (std::size_t i = 0; i < index; ++i) {
+        f = next_format_field(pattern, pos);
+    }
+    return f;
+}
+
+// Upper bound of the number of characters any time_point formats to, without a %Z suffix unless with_zone
+constexpr std::size_t max_formatted_size(const char* pattern, bool with_zone = true) {
+    std::size_t pos = 0;
+    std::size_t n = 0;
+    while (pattern[pos] != '\0') {
+        format_field const f = next_format_field(pattern, pos);
+        switch (f.kind) {
+            case field_kind::mjd:
+            case field_kind::jd:
+                // sign, 7 integer digits, decimal point
+                n += 9 + f.width;
+                break;
+            case field_kind::zone:
+                n += with_zone ? f.width : 0;
+                break;
+            default:
+                n += f.width;
+        }
+    }
+    return n;
+}
+
+constexpr bool has_variable_width(const char* pattern) {
+    std::size_t pos = 0;
+    while (pattern[pos] != '\0') {
+        format_field const f = next_format_field(pattern, pos);
+        if (f.kind == field_kind::mjd || f.kind == field_kind::jd) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Write value as exactly Width decimal digits
+template <int Width>
+inline char* put_digits(char* out, std::uint64_t value) noexcept {
+    for (int i = Width - 1; i >= 0; --i) {
+        out[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    return out + Width;
+}
+
+// Read exactly Width decimal digits
+template <int Width>
+inline bool get_digits(const char*& p, const char* last, std::int64_t& value) noexcept {
+    if (last - p < Width) {
+        return false;
+    }
+    std::int64_t v = 0;
+    for (int i = 0; i < Width; ++i) {
+        unsigned const digit = static_cast<unsigned char>(p[i]) - '0';
+        if (digit > 9) {
+            return false;
+        }
+        v = v * 10 + digit;
+    }
+    p += Width;
+    value = v;
+    return true;
+}
+
+// Time point decomposed into the quantities the field emitters need
+struct broken_down_time {
+    std::int64_t days;         // days since the epoch
+    std::int64_t nsec_of_day;  // [0, NSEC_PER_DAY)
+    civil_date date;
+    unsigned hour;
+    unsigned minute;
+    unsigned second;
+    std::uint32_t nsec;
+};
+
+inline broken_down_time break_down(std::int64_t nsecs) noexcept {
+    broken_down_time t;
+    t.days = floor_div(nsecs, NSEC_PER_DAY);
+    t.nsec_of_day = nsecs - t.days * NSEC_PER_DAY;
+    t.date = civil_from_days(t.days);
+    std::int64_t const secs = t.nsec_of_day / NSEC_PER_SEC;
+    t.hour = static_cast<unsigned>(secs / 3600);
+    t.minute = static_cast<unsigned>(secs / 60 % 60);
+    t.second = static_cast<unsigned>(secs % 60);
+    t.nsec = static_cast<std::uint32_t>(t.nsec_of_day % NSEC_PER_SEC);
+    return t;
+}
+
+// Fields collected while parsing
+struct parsed_time {
+    std::int64_t year = 1970;
+    unsigned month = 1;
+    unsigned day = 1;
+    unsigned day_of_year = 0;  // 0 when not given
+    unsigned hour = 0;
+    unsigned minute = 0;
+    unsigned second = 0;
+    std::uint32_t nsec = 0;
+    bool has_day_number = false;  // set by %Q and %J, which override all calendar fields
+    std::int64_t day_number = 0;  // days since the epoch
+    std::int64_t nsec_of_day = 0;
+};
+
+inline bool to_nanoseconds(parsed_time const& t, std::int64_t& nsecs) noexcept {
+    std::int64_t days;
+    std::int64_t nsec_of_day;
+    if (t.has_day_number) {
+        days = t.day_number;
+        nsec_of_day = t.nsec_of_day;
+    } else {
+        if (t.month < 1 || t.month > 12 || t.hour > 23 || t.minute > 59 || t.second > 60) {
+            return false;
+        }
+        if (t.day_of_year != 0) {
+            if (t.day_of_year > (is_leap_year(t.year) ? 366u : 365u)) {
+                return false;
+            }
+            days = days_from_civil(t.year, 1, 1) + t.day_of_year - 1;
+        } else {
+            if (t.day < 1 || t.day > days_in_month(t.year, t.month)) {
+                return false;
+            }
+            days = days_from_civil(t.year, t.month, t.day);
+        }
+        // A leap second label (second == 60) normalizes to the next minute, as in from_calendar
+        nsec_of_day = ((t.hour * 60 + t.minute) * 60 + t.second) * NSEC_PER_SEC + t.nsec;
+    }
+    if (days < MIN_EPOCH_DAYS || days > MAX_EPOCH_DAYS) {
+        return false;
+    }
+    nsecs = days * NSEC_PER_DAY + nsec_of_day;
+    return true;
+}
+
+// Write (day + nsec_of_day / NSEC_PER_DAY) with Decimals truncated decimals
+template <int Decimals>
+inline char* put_day_number(char* out, std::int64_t day, std::int64_t nsec_of_day) noexcept {
+    std::uint64_t whole;
+    std::int64_t frac = nsec_of_day;
+    if (day < 0) {
+        *out++ = '-';
+        if (frac > 0) {
+            whole = static_cast<std::uint64_t>(-(day + 1));
+            frac = NSEC_PER_DAY - frac;
+        } else {
+            whole = static_cast<std::uint64_t>(-day);
+        }
+    } else {
+        whole = static_cast<std::uint64_t>(day);
+    }
+    char buf[20];
+    int n = 0;
+    do {
+        buf[n++] = static_cast<char>('0' + whole % 10);
+        whole /= 10;
+    } while (whole != 0);
+    while (n > 0) {
+        *out++ = buf[--n];
+    }
+    if (Decimals > 0) {
+        *out++ = '.';
+        for (int i = 0; i < Decimals; ++i) {
+            frac *= 10;
+            *out++ = static_cast<char>('0' + frac / NSEC_PER_DAY);
+            frac %= NSEC_PER_DAY;
+        }
+    }
+    return out;
+}
+
+// Read a day number with exactly Decimals decimals written by put_day_number
+template <int Decimals>
+inline bool get_day_number(const char*& p, const char* last, std::int64_t& day,
+                           std::int64_t& nsec_of_day) noexcept {
+    bool const negative = p != last && *p == '-';
+    const char* q = p + negative;
+    std::int64_t whole = 0;
+    int digits = 0;
+    for (; q != last && static_cast<unsigned>(*q - '0') <= 9; ++q, ++digits) {
+        if (digits == 9) {
+            return false;
+        }
+        whole = whole * 10 + (*q - '0');
+    }
+    if (digits == 0) {
+        return false;
+    }
+    std::int64_t frac = 0;
+    if (Decimals > 0) {
+        if (q == last || *q != '.') {
+            return false;
+        }
+        ++q;
+        if (!get_digits<Decimals>(q, last, frac)) {
+            return false;
+        }
+        frac *= NSEC_PER_DAY / power_of_10(Decimals);
+    }
+    if (negative) {
+        day = -whole - (frac > 0);
+        nsec_of_day = frac > 0 ? NSEC_PER_DAY - frac : 0;
+    } else {
+        day = whole;
+        nsec_of_day = frac;
+    }
+    p = q;
+    return true;
+}
+
+// Emitter and parser for a single pattern field
+template <field_kind Kind, int Width, char Ch>
+struct field_codec;
+
+template <int Width, char Ch>
+struct field_codec<field_kind::literal, Width, Ch> {
+    template <typename Clock>
+    static char* put(char* out, broken_down_time const&) noexcept {
+        *out = Ch;
+        return out + 1;
+    }
+    template <typename Clock>
+    static bool get(const char*& p, const char* last, parsed_time&) noexcept {
+        if (p == last || *p != Ch) {
+            return false;
+        }
+        ++p;
+        return true;
+    }
+};
+
+template <int Width, char Ch>
+struct field_codec<field_kind::year, Width, Ch> {
+    template <typename Clock>
+    static char* put(char* out, broken_down_time const& t) noexcept {
+        return put_digits<4>(out, static_cast<std::uint64_t>(t.date.year));
+    }
+    template <typename Clock>
+    static bool get(const char*& p, const char* last, parsed_time& t) noexcept {
+        return get_digits<4>(p, last, t.year);
+    }
+};
+
+// Two digit calendar and clock fields
+template <unsigned broken_down_time::*Out, unsigned parsed_time::*In>
+struct two_digit_codec {
+    template <typename Clock>
+    static char* put(char* out, broken_down_time const& t) noexcept {
+        return put_digits<2>(out, t.*Out);
+    }
+    template <typename Clock>
+    static bool get(const char*& p, const char* last, parsed_time& t) noexcept {
+        std::int64_t v;
+        if (!get_digits<2>(p, last, v)) {
+            return false;
+        }
+        t.*In = static_cast<unsigned>(v);
+        return true;
+    }
+};
+
+template <int Width, char Ch>
+struct field_codec<field_kind::month, Width, Ch> {
+    template <typename Clock>
+    static char* put(char* out, broken_down_time const& t) noexcept {
+        return put_digits<2>(out, t.date.month);
+    }
+    template <typename Clock>
+    static bool get(const char*& p, const char* last, parsed_time& t) noexcept {
+        std::int64_t v;
+        if (!get_digits<2>(p, last, v)) {
+            return false;
+        }
+        t.month = static_cast<unsigned>(v);
+        return true;
+    }
+};
+
+template <int Width, char Ch>
+struct field_codec<field_kind::day, Width, Ch> {
+    template <typename Clock>
+    static char* put(char* out, broken_down_time const& t) noexcept {
+        return put_digits<2>(out, t.date.day);
+    }
+    template <typename Clock>
+    static bool get(const char*& p, const char* last, parsed_time& t) noexcept {
+        std::int64_t v;
+        if (!get_digits<2>(p, last, v)) {
+            return false;
+        }
+        t.day = static_cast<unsigned>(v);
+        return true;
+    }
+};
+
+template <int Width, char Ch>
+struct field_codec<field_kind::day_of_year, Width, Ch> {
+    template <typename Clock>
+    static char* put(char* out, broken_down_time const& t) noexcept {
+        return put_digits<3>(out, static_cast<std::uint64_t>(t.days - days_from_civil(t.date.year, 1, 1) + 1));
+    }
+    template <typename Clock>
+    static bool get(const char*& p, const char* last, parsed_time& t) noexcept {
+        std::int64_t v;
+        if (!get_digits<3>(p, last, v) || v == 0) {
+            return false;
+        }
+        t.day_of_year = static_cast<unsigned>(v);
+        return true;
+    }
+};
+
+template <int Width, char Ch>
+struct field_codec<field_kind::hour, Width, Ch>
+        : two_digit_codec<&broken_down_time::hour, &parsed_time::hour> {};
+
+template <int Width, char Ch>
+struct field_codec<field_kind::minute, Width, Ch>
+        : two_digit_codec<&broken_down_time::minute, &parsed_time::minute> {};
+
+template <int Width, char Ch>
+struct field_codec<field_kind::second, Width, Ch>
+        : two_digit_codec<&broken_down_time::second, &parsed_time::second> {};
+
+template <int Width, char Ch>
+struct field_codec<field_kind::fraction, Width, Ch> {
+    template <typename Clock>
+    static char* put(char* out, broken_down_time const& t) noexcept {
+        return put_digits<Width>(out, t.nsec / power_of_10(9 - Width));
+    }
+    template <typename Clock>
+    static bool get(const char*& p, const char* last, parsed_time& t) noexcept {
+        std::int64_t v;
+        if (!get_digits<Width>(p, last, v)) {
+            return false;
+        }
+        t.nsec = static_cast<std::uint32_t>(v * power_of_10(9 - Width));
+        return true;
+    }
+};
+
+template <int Width, char Ch>
+struct field_codec<field_kind::mjd, Width, Ch> {
+    template <typename Clock>
+    static char* put(char* out, broken_down_time const& t) noexcept {
+        return put_day_number<Width>(out, t.days + EPOCH_MJD, t.nsec_of_day);
+    }
+    template <typename Clock>
+    static bool get(const char*& p, const char* last, parsed_time& t) noexcept {
+        std::int64_t day;
+        if (!get_day_number<Width>(p, last, day, t.nsec_of_day)) {
+            return false;
+        }
+        t.has_day_number = true;
+        t.day_number = day - EPOCH_MJD;
+        return true;
+    }
+};
+
+// JD days start at noon, JD 2440588.0 = 1970-01-01T12:00:00
+template <int Width, char Ch>
+struct field_codec<field_kind::jd, Width, Ch> {
+    static constexpr std::int64_t EPOCH_JD = 2440587;
+
+    template <typename Clock>
+    static char* put(char* out, broken_down_time const& t) noexcept {
+        std::int64_t day = t.days + EPOCH_JD;
+        std::int64_t nsec_of_day = t.nsec_of_day + NSEC_PER_DAY / 2;
+        if (nsec_of_day >= NSEC_PER_DAY) {
+            nsec_of_day -= NSEC_PER_DAY;
+            ++day;
+        }
+        return put_day_number<Width>(out, day, nsec_of_day);
+    }
+    template <typename Clock>
+    static bool get(const char*& p, const char* last, parsed_time& t) noexcept {
+        std::int64_t day;
+        std::int64_t nsec_of_day;
+        if (!get_day_number<Width>(p, last, day, nsec_of_day)) {
+            return false;
+        }
+        nsec_of_day -= NSEC_PER_DAY / 2;
+        if (nsec_of_day < 0) {
+            nsec_of_day += NSEC_PER_DAY;
+            --day;
+        }
+        t.has_day_number = true;
+        t.day_number = day - EPOCH_JD;
+        t.nsec_of_day = nsec_of_day;
+        return true;
+    }
+};
+
+// UTC has a "Z" suffix, TAI and TT do not
+template <int Width, char Ch>
+struct field_codec<field_kind::zone, Width, Ch> {
+    template <typename Clock>
+    static char* put(char* out, broken_down_time const&) noexcept {
+        if (std::is_same<Clock, utc_clock>::value) {
+            *out++ = 'Z';
+        }
+        return out;
+    }
+    template <typename Clock>
+    static bool get(const char*& p, const char* last, parsed_time&) noexcept {
+        if (std::is_same<Clock, utc_clock>::value) {
+            if (p == last || *p != 'Z') {
+                return false;
+            }
+            ++p;
+        }
+        return true;
+    }
+};
+
+}  // namespace detail
+
+template <typename Pattern>
+class time_format {
+    static constexpr std::size_t field_count = detail::count_format_fields(Pattern::pattern());
+
+    template <std::size_t I>
+    using codec = detail::field_codec<detail::format_field_at(Pattern::pattern(), I).kind,
+                                      detail::format_field_at(Pattern::pattern(), I).width,
+                                      detail::format_field_at(Pattern::pattern(), I).ch>;
+
+    template <typename Clock, std::size_t... I>
+    static char* put_fields(char* out, detail::broken_down_time const& t, std::index_sequence<I...>) noexcept {
+        using expand = int[];
+        (void)expand{0, ((out = codec<I>::template put<Clock>(out, t)), 0)...};
+        return out;
+    }
+
+    template <typename Clock, std::size_t... I>
+    static bool get_fields(const char*& p, const char* last, detail::parsed_time& t,
+                           std::index_sequence<I...>) noexcept {
+        bool ok = true;
+        using expand = int[];
+        (void)expand{0, ((ok = ok && codec<I>::template get<Clock>(p, last, t)), 0)...};
+        return ok;
+    }
+
+public:
+    // Maximum number of characters written by format_to
+    static constexpr std::size_t max_size = detail::max_formatted_size(Pattern::pattern());
+
+    // True if every time_point of a clock formats to exactly fixed_size<Clock>() characters
+    static constexpr bool is_fixed_width = !detail::has_variable_width(Pattern::pattern());
+
+    // Number of characters a time_point of Clock formats to if is_fixed_width (%Z is empty except for UTC)
+    template <typename Clock>
+    static constexpr std::size_t fixed_size() noexcept {
+        return detail::max_formatted_size(Pattern::pattern(), std::is_same<Clock, utc_clock>::value);
+    }
+
+    // Write tp to [out, out + max_size) and return the end of the written characters
+    template <typename TimePoint>
+    static char* format_to(char* out, TimePoint const& tp) noexcept {
+        auto const nsecs = std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch());
+        return put_fields<typename TimePoint::clock>(out, detail::break_down(nsecs.count()),
+                                                     std::make_index_sequence<field_count>{});
+    }
+
+    template <typename TimePoint>
+    static std::string format(TimePoint const& tp) {
+        char buf[max_size];
+        return std::string(buf, format_to(buf, tp));
+    }
+
+    // Parse [first, last), returns false if it does not match the pattern or is out of range
+    template <typename Clock>
+    static bool parse(const char* first, const char* last, typename Clock::time_point& tp) noexcept {
+        detail::parsed_time t;
+        std::int64_t nsecs;
+        if (!get_fields<Clock>(first, last, t, std::make_index_sequence<field_count>{}) || first != last ||
+            !detail::to_nanoseconds(t, nsecs)) {
+            return false;
+        }
+        tp = typename Clock::time_point{std::chrono::nanoseconds{nsecs}};
+        return true;
+    }
+
+    template <typename Clock>
+    static typename Clock::time_point parse(std::string const& str) {
+        typename Clock::time_point tp;
+        if (!parse<Clock>(str.data(), str.data() + str.size(), tp)) {
+            throw std::invalid_argument(std::string("Not in format ") + Pattern::pattern() + ": " + str);
+        }
+        return tp;
+    }
+};
+
+template <typename Pattern>
+constexpr std::size_t time_format<Pattern>::max_size;
+
+template <typename Pattern>
+constexpr bool time_format<Pattern>::is_fixed_width;
+
+}  // namespace astrochrono
+
+#endif  // ASTROCHRONO_FORMAT_H
@@ -0,0 +1,250 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef ASTROCHRONO_INDEX_H
+#define ASTROCHRONO_INDEX_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "astrochrono.h"
+
+namespace astrochrono {
+
+/* Read-only search index over a sorted array of time points.
+ *
+ * The index is an implicit static B-tree: every level holds every node_size-th key of the level
+ * below it, the bottom level being the indexed array itself. A search scans one node of node_size
+ * keys per level with a branch-free count (which the compiler vectorizes) instead of the
+ * unpredictable branches and scattered loads of a binary search. The index only adds about
+ * 1/node_size of the array size and does not copy the array, which must outlive the index.
+ *
+ * Queries may be given in any clock, they are converted with timescale_cast, e.g.
+ *
+ *     time_index<utc_clock> index(detections.data(), detections.size());
+ *     auto r = index.range(tai_clock::from_mjd(a), tai_clock::from_mjd(b));
+ */
+template <typename Clock>
+class time_index {
+public:
+    using clock = Clock;
+    using time_point = typename Clock::time_point;
+
+    static constexpr std::size_t node_size = 16;
+
+    time_index(time_point const *data, std::size_t n) : data_(data), size_(n) {
+        std::vector<std::int64_t> level;
+        for (std::size_t i = 0; i < n; i += node_size) {
+            level.push_back(data[i].time_since_epoch().count());
+        }
+        while (n > node_size) {
+            n = level.size();
+            pad(level);
+            levels_.push_back(level);
+            std::vector<std::int64_t> up;
+            for (std::size_t i = 0; i < n; i += node_size) {
+                up.push_back(level[i]);
+            }
+            level.swap(up);
+        }
+        std::reverse(levels_.begin(), levels_.end());
+    }
+
+    std::size_t size() const noexcept { return size_; }
+
+    time_point const *data() const noexcept { return data_; }
+
+    // Index of the first time point not before tp
+    template <typename TimePoint>
+    std::size_t lower_bound(TimePoint const &tp) const {
+        return search(key(tp));
+    }
+
+    // Index of the first time point after tp
+    template <typename TimePoint>
+    std::size_t upper_bound(TimePoint const &tp) const {
+        std::int64_t const k = key(tp);
+        return k == std::numeric_limits<std::int64_t>::max() ? size_ : search(k + 1);
+    }
+
+    // Index range [first, last) of the time points in [from, to)
+    template <typename TimePoint>
+    std::pair<std::size_t, std::size_t> range(TimePoint const &from, TimePoint const &to) const {
+        return std::make_pair(lower_bound(from), lower_bound(to));
+    }
+
+    // Index range of the time points with from <= MJD < to on QueryClock
+    template <typename QueryClock>
+    std::pair<std::size_t, std::size_t> range_mjd(double from, double to) const {
+        return range(QueryClock::from_mjd(from), QueryClock::from_mjd(to));
+    }
+
+    // Index of the time point closest to tp (the earlier one on a tie), or size() if empty
+    template <typename TimePoint>
+    std::size_t nearest(TimePoint const &tp) const {
+        std::int64_t const k = key(tp);
+        return closest(k, search(k));
+    }
+
+    // Batched versions, which interleave the searches of a group of queries to overlap cache misses
+    template <typename TimePoint>
+    void lower_bound(TimePoint const *queries, std::size_t n, std::size_t *out) const {
+        std::int64_t keys[batch_size];
+        for (std::size_t i = 0; i < n; i += batch_size) {
+            std::size_t const m = std::min(batch_size, n - i);
+            for (std::size_t j = 0; j < m; ++j) {
+                keys[j] = key(queries[i + j]);
+            }
+            search(keys, m, out + i);
+        }
+    }
+
+    template <typename TimePoint>
+    void range(TimePoint const *from, TimePoint const *to, std::size_t n,
+               std::pair<std::size_t, std::size_t> *out) const {
+        std::size_t first[batch_size];
+        std::size_t last[batch_size];
+        for (std::size_t i = 0; i < n; i += batch_size) {
+            std::size_t const m = std::min(batch_size, n - i);
+            lower_bound(from + i, m, first);
+            lower_bound(to + i, m, last);
+            for (std::size_t j = 0; j < m; ++j) {
+                out[i + j] = std::make_pair(first[j], last[j]);
+            }
+        }
+    }
+
+    template <typename TimePoint>
+    void nearest(TimePoint const *queries, std::size_t n, std::size_t *out) const {
+        std::int64_t keys[batch_size];
+        for (std::size_t i = 0; i < n; i += batch_size) {
+            std::size_t const m = std::min(batch_size, n - i);
+            for (std::size_t j = 0; j < m; ++j) {
+                keys[j] = key(queries[i + j]);
+            }
+            search(keys, m, out + i);
+            for (std::size_t j = 0; j < m; ++j) {
+                out[i + j] = closest(keys[j], out[i + j]);
+            }
+        }
+    }
+
+private:
+    static constexpr std::size_t batch_size = 16;
+
+    template <typename TimePoint>
+    static std::int64_t key(TimePoint const &tp) {
+        return timescale_cast<Clock>(tp).time_since_epoch().count();
+    }
+
+    // Pad a level to whole nodes with keys that never compare less than a query
+    static void pad(std::vector<std::int64_t> &level) {
+        level.resize((level.size() + node_size - 1) / node_size * node_size,
+                     std::numeric_limits<std::int64_t>::max());
+    }
+
+    static std::size_t count_less(std::int64_t const *node, std::int64_t k) noexcept {
+        std::size_t c = 0;
+        for (std::size_t i = 0; i < node_size; ++i) {
+            c += node[i] < k;
+        }
+        return c;
+    }
+
+    // Position in the indexed array given position p in the level above it
+    std::size_t search_data(std::size_t p, std::int64_t k) const noexcept {
+        if (p == 0) {
+            return 0;
+        }
+        std::size_t const first = (p - 1) * node_size;
+        std::size_t const last = std::min(first + node_size, size_);
+        std::size_t c = 0;
+        for (std::size_t i = first; i < last; ++i) {
+            c += data_[i].time_since_epoch().count() < k;
+        }
+        return first + c;
+    }
+
+    // Position in level l given position p in the level above it
+    std::size_t search_level(std::size_t l, std::size_t p, std::int64_t k) const noexcept {
+        if (p == 0) {
+            return 0;
+        }
+        std::size_t const first = (p - 1) * node_size;
+        return first + count_less(levels_[l].data() + first, k);
+    }
+
+    std::size_t search(std::int64_t k) const noexcept {
+        std::size_t p = 1;
+        for (std::size_t l = 0; l < levels_.size(); ++l) {
+            p = search_level(l, p, k);
+        }
+        return search_data(p, k);
+    }
+
+    void search(std::int64_t const *keys, std::size_t m, std::size_t *out) const noexcept {
+        std::size_t p[batch_size];
+        std::fill(p, p + m, std::size_t{1});
+        for (std::size_t l = 0; l < levels_.size(); ++l) {
+            for (std::size_t j = 0; j < m; ++j) {
+                p[j] = search_level(l, p[j], keys[j]);
+            }
+        }
+        for (std::size_t j = 0; j < m; ++j) {
+            out[j] = search_data(p[j], keys[j]);
+        }
+    }
+
+    std::size_t closest(std::int64_t k, std::size_t p) const noexcept {
+        if (p == size_) {
+            return size_ == 0 ? 0 : size_ - 1;
+        }
+        if (p == 0) {
+            return 0;
+        }
+        // compare distances as unsigned to avoid overflow
+        auto const before = static_cast<std::uint64_t>(k) -
+                            static_cast<std::uint64_t>(data_[p - 1].time_since_epoch().count());
+        auto const after = static_cast<std::uint64_t>(data_[p].time_since_epoch().count()) -
+                           static_cast<std::uint64_t>(k);
+        return before <= after ? p - 1 : p;
+    }
+
+    time_point const *data_;
+    std::size_t size_;
+    std::vector<std::vector<std::int64_t>> levels_;  // top level first
+};
+
+template <typename Clock>
+constexpr std::size_t time_index<Clock>::node_size;
+
+template <typename Clock>
+constexpr std::size_t time_index<Clock>::batch_size;
+
+}  // namespace astrochrono
+
+#endif  // ASTROCHRONO_INDEX_H
@@ -0,0 +1,331 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+#ifndef ASTROCHRONO_INTERVAL_H
+#define ASTROCHRONO_INTERVAL_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <vector>
+
+#include "astrochrono.h"
+
+namespace astrochrono {
+
+namespace detail {
+
+// TAI nanosecs of a time point, time_point::min() and max() stand for the unbounded ends
+template <typename TimePoint>
+std::int64_t interval_bound_to_tai(TimePoint const &tp) {
+    if (tp == TimePoint::min() || tp == TimePoint::max()) {
+        return tp.time_since_epoch().count();
+    }
+    return timescale_cast<tai_clock>(tp).time_since_epoch().count();
+}
+
+// Earliest Clock time point at or after the TAI nanosecs t. Conversions to TAI increase
+// strictly, so a TAI interval [a, b) holds exactly the time points in [ceil(a), ceil(b)).
+// Within a leap second that is the start of the following UTC minute.
+template <typename Clock>
+typename Clock::time_point interval_bound_from_tai(std::int64_t t) {
+    using time_point = typename Clock::time_point;
+    if (t == std::numeric_limits<std::int64_t>::min() || t == std::numeric_limits<std::int64_t>::max()) {
+        return time_point{std::chrono::nanoseconds{t}};
+    }
+    time_point tp = timescale_cast<Clock>(tai_clock::time_point{std::chrono::nanoseconds{t}});
+    // only moves for leap seconds and the rounding of pre-1972 drift terms
+    for (int i = 0; i < 4; ++i) {
+        std::int64_t const d = interval_bound_to_tai(tp) - t;
+        if (d < 0) {
+            tp += std::chrono::nanoseconds{-d};
+        } else if (d > 0) {
+            time_point const back = tp - std::chrono::nanoseconds{d};
+            if (interval_bound_to_tai(back) >= t) {
+                tp = back;
+            } else {
+                // t falls in a gap of Clock (a leap second), which ends at the start of a segment
+                tp = std::max(back + std::chrono::nanoseconds{1}, find_timescale_segment<tai_clock>(tp).first);
+                break;
+            }
+        } else {
+            break;
+        }
+    }
+    return tp;
+}
+
+}  // namespace detail
+
+/* Set of disjoint half-open time intervals [first, last), such as good time intervals (GTIs).
+ *
+ * Intervals are stored as sorted TAI boundaries whatever the time scale of Clock, so sets on
+ * different time scales combine directly and timescale_cast of a whole set is free. An interval
+ * given on UTC that spans a leap second includes it. time_point::min() and max() stand for
+ * unbounded ends, the complement of the empty set is [min(), max()).
+ *
+ * The set operations are a single merge of the boundaries, O(n + m). mask and filter select the
+ * events inside the intervals from a sorted array of time points on any time scale.
+ */
+template <typename Clock>
+class interval_set {
+public:
+    using clock = Clock;
+    using time_point = typename Clock::time_point;
+
+    struct interval {
+        time_point first;
+        time_point last;  // excluded
+    };
+
+    interval_set() = default;
+
+    interval_set(std::initializer_list<interval> intervals) : interval_set(intervals.begin(), intervals.end()) {}
+
+    // Intervals in any order, overlapping and adjacent intervals are merged and empty ones dropped
+    template <typename Iterator>
+    interval_set(Iterator first, Iterator last) {
+        std::vector<std::pair<std::int64_t, std::int64_t>> tai;
+        for (; first != last; ++first) {
+            std::int64_t const a = detail::interval_bound_to_tai(first->first);
+            std::int64_t const b = detail::interval_bound_to_tai(first->last);
+            if (a < b) {
+                tai.emplace_back(a, b);
+            }
+        }
+        std::sort(tai.begin(), tai.end());
+        for (auto const &i : tai) {
+            if (!bounds_.empty() && i.first <= bounds_.back()) {
+                bounds_.back() = std::max(bounds_.back(), i.second);
+            } else {
+                bounds_.push_back(i.first);
+                bounds_.push_back(i.second);
+            }
+        }
+    }
+
+    void insert(time_point first, time_point last) { *this = *this | interval_set{{first, last}}; }
+
+    std::size_t size() const noexcept { return bounds_.size() / 2; }
+
+    bool empty() const noexcept { return bounds_.empty(); }
+
+    // Interval i in order, see detail::interval_bound_from_tai for bounds within a leap second
+    interval operator[](std::size_t i) const {
+        return interval{detail::interval_bound_from_tai<Clock>(bounds_[2 * i]),
+                        detail::interval_bound_from_tai<Clock>(bounds_[2 * i + 1])};
+    }
+
+    std::vector<interval> intervals() const {
+        std::vector<interval> result;
+        result.reserve(size());
+        for (std::size_t i = 0; i < size(); ++i) {
+            result.push_back((*this)[i]);
+        }
+        return result;
+    }
+
+    // Sorted TAI nanosecs of the interval boundaries, first and last of each interval in turn
+    std::vector<std::int64_t> const &boundaries() const noexcept { return bounds_; }
+
+    // Total length of the intervals in SI seconds, duration::max() if unbounded
+    std::chrono::nanoseconds exposure() const noexcept {
+        if (!bounds_.empty() && (bounds_.front() == std::numeric_limits<std::int64_t>::min() ||
+                                 bounds_.back() == std::numeric_limits<std::int64_t>::max())) {
+            return std::chrono::nanoseconds::max();
+        }
+        std::int64_t total = 0;
+        for (std::size_t i = 0; i < bounds_.size(); i += 2) {
+            total += bounds_[i + 1] - bounds_[i];
+        }
+        return std::chrono::nanoseconds{total};
+    }
+
+    template <typename TimePoint>
+    bool contains(TimePoint const &tp) const {
+        std::int64_t const t = detail::interval_bound_to_tai(tp);
+        // inside if an odd number of boundaries is at or before t
+        return (std::upper_bound(bounds_.begin(), bounds_.end(), t) - bounds_.begin()) % 2 == 1;
+    }
+
+    // Set mask[i] to 1 for the events inside the set and to 0 for the others, returns the number
+    // inside. The events must be sorted.
+    template <typename TimePoint>
+    std::size_t mask(TimePoint const *events, std::size_t n, std::uint8_t *mask) const {
+        std::size_t count = 0;
+        walk(events, n, [&](std::size_t first, std::size_t last, bool inside) {
+            std::fill(mask + first, mask + last, static_cast<std::uint8_t>(inside));
+            count += inside ? last - first : 0;
+        });
+        return count;
+    }
+
+    // Copy the events inside the set to out, returns their number. The events must be sorted.
+    template <typename TimePoint>
+    std::size_t filter(TimePoint const *events, std::size_t n, TimePoint *out) const {
+        std::size_t count = 0;
+        walk(events, n, [&](std::size_t first, std::size_t last, bool inside) {
+            if (inside) {
+                out = std::copy(events + first, events + last, out);
+                count += last - first;
+            }
+        });
+        return count;
+    }
+
+    // Complement within [time_point::min(), time_point::max())
+    interval_set operator~() const {
+        interval_set result;
+        std::int64_t const min = std::numeric_limits<std::int64_t>::min();
+        std::int64_t const max = std::numeric_limits<std::int64_t>::max();
+        bool const from_min = bounds_.empty() || bounds_.front() != min;
+        bool const to_max = bounds_.empty() || bounds_.back() != max;
+        result.bounds_.reserve(bounds_.size() + 2);
+        if (from_min) {
+            result.bounds_.push_back(min);
+        }
+        result.bounds_.insert(result.bounds_.end(), bounds_.begin() + (from_min ? 0 : 1),
+                              bounds_.end() - (to_max ? 0 : 1));
+        if (to_max) {
+            result.bounds_.push_back(max);
+        }
+        return result;
+    }
+
+    // Set operations with sets on any time scale, the result is on the time scale of the left operand
+    template <typename OtherClock>
+    interval_set operator|(interval_set<OtherClock> const &other) const {
+        return combine(other, [](bool a, bool b) { return a || b; });
+    }
+
+    template <typename OtherClock>
+    interval_set operator&(interval_set<OtherClock> const &other) const {
+        return combine(other, [](bool a, bool b) { return a && b; });
+    }
+
+    template <typename OtherClock>
+    interval_set operator-(interval_set<OtherClock> const &other) const {
+        return combine(other, [](bool a, bool b) { return a && !b; });
+    }
+
+    template <typename OtherClock>
+    interval_set operator^(interval_set<OtherClock> const &other) const {
+        return combine(other, [](bool a, bool b) { return a != b; });
+    }
+
+    template <typename OtherClock>
+    bool operator==(interval_set<OtherClock> const &other) const {
+        return bounds_ == other.bounds_;
+    }
+
+    template <typename OtherClock>
+    bool operator!=(interval_set<OtherClock> const &other) const {
+        return bounds_ != other.bounds_;
+    }
+
+private:
+    template <typename>
+    friend class interval_set;
+
+    template <typename ToClock, typename FromClock>
+    friend interval_set<ToClock> timescale_cast(interval_set<FromClock> const &);
+
+    // Number of events converted to TAI at once
+    static constexpr std::size_t block_size = 256;
+
+    // Boundaries where op(inside this, inside other) changes, by merging the two boundary lists
+    template <typename OtherClock, typename Op>
+    interval_set combine(interval_set<OtherClock> const &other, Op op) const {
+        std::vector<std::int64_t> const &a = bounds_;
+        std::vector<std::int64_t> const &b = other.bounds_;
+        interval_set result;
+        result.bounds_.reserve(a.size() + b.size());
+        std::size_t i = 0;
+        std::size_t j = 0;
+        bool in_a = false;
+        bool in_b = false;
+        bool inside = false;
+        while (i < a.size() || j < b.size()) {
+            std::int64_t const t = j == b.size() || (i < a.size() && a[i] < b[j]) ? a[i] : b[j];
+            if (i < a.size() && a[i] == t) {
+                in_a = !in_a;
+                ++i;
+            }
+            if (j < b.size() && b[j] == t) {
+                in_b = !in_b;
+                ++j;
+            }
+            if (op(in_a, in_b) != inside) {
+                inside = !inside;
+                result.bounds_.push_back(t);
+            }
+        }
+        return result;
+    }
+
+    // Call f(first, last, inside) for consecutive runs [first, last) of the sorted events that
+    // are all inside or all outside the set. The events are converted to TAI a block at a time
+    // and the runs found by binary search, so the per event work is a fill or copy.
+    template <typename TimePoint, typename F>
+    void walk(TimePoint const *events, std::size_t n, F f) const {
+        tai_clock::time_point tai[block_size];
+        // number of boundaries at or before the current event
+        std::size_t j = 0;
+        for (std::size_t offset = 0; offset < n; offset += block_size) {
+            std::size_t const m = std::min(block_size, n - offset);
+            timescale_cast<tai_clock>(events + offset, m, tai);
+            std::size_t p = 0;
+            while (p < m) {
+                std::int64_t const t = tai[p].time_since_epoch().count();
+                j = std::upper_bound(bounds_.begin() + j, bounds_.end(), t) - bounds_.begin();
+                std::size_t q = m;
+                if (j < bounds_.size()) {
+                    tai_clock::time_point const next{std::chrono::nanoseconds{bounds_[j]}};
+                    q = std::lower_bound(tai + p, tai + m, next) - tai;
+                }
+                f(offset + p, offset + q, j % 2 == 1);
+                p = q;
+            }
+        }
+    }
+
+    std::vector<std::int64_t> bounds_;
+};
+
+template <typename Clock>
+constexpr std::size_t interval_set<Clock>::block_size;
+
+// The same intervals on another time scale; the boundaries are stored on TAI and do not change
+template <typename ToClock, typename FromClock>
+interval_set<ToClock> timescale_cast(interval_set<FromClock> const &set) {
+    interval_set<ToClock> result;
+    result.bounds_ = set.bounds_;
+    return result;
+}
+
+}  // namespace astrochrono
+
+#endif  // ASTROCHRONO_INTERVAL_H
@@ -0,0 +1,140 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+#ifndef ASTROCHRONO_LEAP_H
+#define ASTROCHRONO_LEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "astrochrono.h"
+
+namespace astrochrono {
+
+namespace detail {
+
+// Difference between Terrestrial Time and TAI in nanoseconds
+constexpr std::int64_t TT_MINUS_TAI_NS = 32184000000LL;
+
+// Entry of the TAI - UTC table: from UTC MJD mjd on,
+// TAI - UTC = offset_ns + (MJD - ref_mjd) * drift_ns nanoseconds
+struct leap_entry {
+    std::int64_t mjd;
+    std::int64_t offset_ns;
+    std::int64_t ref_mjd;
+    std::int64_t drift_ns;  // per day
+};
+
+// Source: http://maia.usno.navy.mil/ser7/tai-utc.dat
+// The table is shared by the runtime conversions and the compile time ones of astrochrono_literals.h.
+constexpr leap_entry leap_seconds[] = {
+        {37300, 1422818000, 37300, 1296000},   // 1961 JAN  1
+        {37512, 1372818000, 37300, 1296000},   // 1961 AUG  1
+        {37665, 1845858000, 37665, 1123200},   // 1962 JAN  1
+        {38334, 1945858000, 37665, 1123200},   // 1963 NOV  1
+        {38395, 3240130000, 38761, 1296000},   // 1964 JAN  1
+        {38486, 3340130000, 38761, 1296000},   // 1964 APR  1
+        {38639, 3440130000, 38761, 1296000},   // 1964 SEP  1
+        {38761, 3540130000, 38761, 1296000},   // 1965 JAN  1
+        {38820, 3640130000, 38761, 1296000},   // 1965 MAR  1
+        {38942, 3740130000, 38761, 1296000},   // 1965 JUL  1
+        {39004, 3840130000, 38761, 1296000},   // 1965 SEP  1
+        {39126, 4313170000, 39126, 2592000},   // 1966 JAN  1
+        {39887, 4213170000, 39126, 2592000},   // 1968 FEB  1
+        {41317, 10000000000, 41317, 0},        // 1972 JAN  1
+        {41499, 11000000000, 41317, 0},        // 1972 JUL  1
+        {41683, 12000000000, 41317, 0},        // 1973 JAN  1
+        {42048, 13000000000, 41317, 0},        // 1974 JAN  1
+        {42413, 14000000000, 41317, 0},        // 1975 JAN  1
+        {42778, 15000000000, 41317, 0},        // 1976 JAN  1
+        {43144, 16000000000, 41317, 0},        // 1977 JAN  1
+        {43509, 17000000000, 41317, 0},        // 1978 JAN  1
+        {43874, 18000000000, 41317, 0},        // 1979 JAN  1
+        {44239, 19000000000, 41317, 0},        // 1980 JAN  1
+        {44786, 20000000000, 41317, 0},        // 1981 JUL  1
+        {45151, 21000000000, 41317, 0},        // 1982 JUL  1
+        {45516, 22000000000, 41317, 0},        // 1983 JUL  1
+        {46247, 23000000000, 41317, 0},        // 1985 JUL  1
+        {47161, 24000000000, 41317, 0},        // 1988 JAN  1
+        {47892, 25000000000, 41317, 0},        // 1990 JAN  1
+        {48257, 26000000000, 41317, 0},        // 1991 JAN  1
+        {48804, 27000000000, 41317, 0},        // 1992 JUL  1
+        {49169, 28000000000, 41317, 0},        // 1993 JUL  1
+        {49534, 29000000000, 41317, 0},        // 1994 JUL  1
+        {50083, 30000000000, 41317, 0},        // 1996 JAN  1
+        {50630, 31000000000, 41317, 0},        // 1997 JUL  1
+        {51179, 32000000000, 41317, 0},        // 1999 JAN  1
+        {53736, 33000000000, 41317, 0},        // 2006 JAN  1
+        {54832, 34000000000, 41317, 0},        // 2009 JAN  1
+        {56109, 35000000000, 41317, 0},        // 2012 JUL  1
+        {57204, 36000000000, 41317, 0},        // 2015 JUL  1
+        {57754, 37000000000, 41317, 0},        // 2017 JAN  1
+};
+
+constexpr std::size_t leap_second_count = sizeof(leap_seconds) / sizeof(leap_seconds[0]);
+
+// UTC nanosecs of the start of the entry
+constexpr std::int64_t leap_when_utc(leap_entry const& e) noexcept { return (e.mjd - EPOCH_MJD) * NSEC_PER_DAY; }
+
+// UTC nanosecs of the MJD interpolation intercept
+constexpr std::int64_t leap_ref_ns(leap_entry const& e) noexcept { return (e.ref_mjd - EPOCH_MJD) * NSEC_PER_DAY; }
+
+// Slope of the interpolation in nanoseconds per nanosecond, times 2^64
+constexpr std::uint64_t leap_rate(leap_entry const& e) noexcept {
+    return static_cast<std::uint64_t>(
+            ((static_cast<unsigned __int128>(e.drift_ns) << 64) + NSEC_PER_DAY / 2) / NSEC_PER_DAY);
+}
+
+// leap_rate / (1 + leap_rate), times 2^64, for the TAI -> UTC direction
+constexpr std::uint64_t leap_inverse_rate(leap_entry const& e) noexcept {
+    return static_cast<std::uint64_t>(((static_cast<unsigned __int128>(e.drift_ns) << 64) + NSEC_PER_DAY / 2) /
+                                      (NSEC_PER_DAY + e.drift_ns));
+}
+
+// Round x * rate / 2^64 to the nearest integer
+constexpr std::int64_t multiply_shift(std::int64_t x, std::uint64_t rate) noexcept {
+    // a single 64 x 64 -> 128 bit unsigned multiplication, corrected for the sign of x
+    unsigned __int128 const product = static_cast<unsigned __int128>(static_cast<std::uint64_t>(x)) * rate;
+    std::uint64_t const high = static_cast<std::uint64_t>(product >> 64) - (x < 0 ? rate : 0);
+    return static_cast<std::int64_t>(high + (static_cast<std::uint64_t>(product) >> 63));
+}
+
+// TAI nanosecs of UTC nanosecs utc, throws std::domain_error before the start of the table
+constexpr std::int64_t utc_to_tai_nsecs(std::int64_t utc) {
+    std::size_t i = leap_second_count;
+    while (i > 0 && utc < leap_when_utc(leap_seconds[i - 1])) {
+        --i;
+    }
+    if (i == 0) {
+        throw std::domain_error("DateTime value too early for UTC->TAI conversion");
+    }
+    leap_entry const& e = leap_seconds[i - 1];
+    return utc + e.offset_ns + multiply_shift(utc - leap_ref_ns(e), leap_rate(e));
+}
+
+}  // namespace detail
+
+}  // namespace astrochrono
+
+#endif  // ASTROCHRONO_LEAP_H
@@ -0,0 +1,162 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+#ifndef ASTROCHRONO_LITERALS_H
+#define ASTROCHRONO_LITERALS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "astrochrono.h"
+#include "astrochrono_leap.h"
+#include "astrochrono_parse.h"
+
+namespace astrochrono {
+
+namespace detail {
+
+// Nanoseconds since the epoch on the time scale of Clock of UTC nanosecs utc
+template <typename Clock>
+constexpr std::int64_t nsecs_from_utc(std::int64_t utc);
+
+template <>
+constexpr std::int64_t nsecs_from_utc<utc_clock>(std::int64_t utc) {
+    return utc;
+}
+
+template <>
+constexpr std::int64_t nsecs_from_utc<tai_clock>(std::int64_t utc) {
+    return utc_to_tai_nsecs(utc);
+}
+
+template <>
+constexpr std::int64_t nsecs_from_utc<tt_clock>(std::int64_t utc) {
+    return utc_to_tai_nsecs(utc) + TT_MINUS_TAI_NS;
+}
+
+// Time point of an ISO 8601 string literal, converted from UTC if it has a "Z" suffix
+template <typename Clock>
+constexpr typename Clock::time_point iso8601_literal(const char* first, const char* last) {
+    timestamp_format const format = sniff_timestamp(first, last);
+    decoded_timestamp decoded{0, false};
+    if ((format != timestamp_format::iso8601_extended && format != timestamp_format::iso8601_basic) ||
+        !decode_timestamp(format, first, last, decoded)) {
+        throw std::invalid_argument("Malformed ISO 8601 time literal");
+    }
+    return typename Clock::time_point{
+            std::chrono::nanoseconds{decoded.is_utc ? nsecs_from_utc<Clock>(decoded.nsecs) : decoded.nsecs}};
+}
+
+// Nanoseconds of a numeric MJD (or JD if julian) literal with characters Chars
+template <bool Julian, char... Chars>
+struct day_number_literal {
+    static constexpr char chars[] = {Chars...};
+
+    static constexpr std::int64_t decode() {
+        decoded_timestamp decoded{0, false};
+        if (!(Julian ? decode_jd(chars, chars + sizeof...(Chars), decoded)
+                     : decode_mjd(chars, chars + sizeof...(Chars), decoded))) {
+            throw std::invalid_argument(Julian ? "Malformed JD time literal" : "Malformed MJD time literal");
+        }
+        return decoded.nsecs;
+    }
+
+    // a static data member forces evaluation, and so rejection of malformed literals, at compile time
+    static constexpr std::int64_t nsecs = decode();
+};
+
+template <bool Julian, char... Chars>
+constexpr char day_number_literal<Julian, Chars...>::chars[];
+
+template <bool Julian, char... Chars>
+constexpr std::int64_t day_number_literal<Julian, Chars...>::nsecs;
+
+}  // namespace detail
+
+/* User-defined literals for time_point constants, evaluated at compile time.
+ *
+ *     using namespace astrochrono::literals;
+ *     constexpr auto t0 = "2017-01-01T00:00:00Z"_tai;  // converted from UTC, 2017-01-01T00:00:37 TAI
+ *     constexpr auto t1 = 57754.5_mjd_tai;
+ *
+ * String literals accept the ISO 8601 forms of timestamp_parser. Those with a "Z" suffix are UTC and
+ * are converted with the leap second table of astrochrono_leap.h, others are on the time scale of
+ * the literal. They are constexpr functions, so they are evaluated, and malformed ones rejected, at
+ * compile time whenever the result initializes a constexpr variable (or any other constant
+ * expression); a static variable initialized by a well-formed literal is also constant
+ * initialized, without work at load time.
+ *
+ * The numeric MJD and JD literals are on the time scale of their suffix and are always evaluated
+ * at compile time.
+ */
+inline namespace literals {
+
+constexpr utc_clock::time_point operator"" _utc(const char* str, std::size_t len) {
+    return detail::iso8601_literal<utc_clock>(str, str + len);
+}
+
+constexpr tai_clock::time_point operator"" _tai(const char* str, std::size_t len) {
+    return detail::iso8601_literal<tai_clock>(str, str + len);
+}
+
+constexpr tt_clock::time_point operator"" _tt(const char* str, std::size_t len) {
+    return detail::iso8601_literal<tt_clock>(str, str + len);
+}
+
+template <char... Chars>
+constexpr utc_clock::time_point operator"" _mjd_utc() {
+    return utc_clock::time_point{std::chrono::nanoseconds{detail::day_number_literal<false, Chars...>::nsecs}};
+}
+
+template <char... Chars>
+constexpr tai_clock::time_point operator"" _mjd_tai() {
+    return tai_clock::time_point{std::chrono::nanoseconds{detail::day_number_literal<false, Chars...>::nsecs}};
+}
+
+template <char... Chars>
+constexpr tt_clock::time_point operator"" _mjd_tt() {
+    return tt_clock::time_point{std::chrono::nanoseconds{detail::day_number_literal<false, Chars...>::nsecs}};
+}
+
+template <char... Chars>
+constexpr utc_clock::time_point operator"" _jd_utc() {
+    return utc_clock::time_point{std::chrono::nanoseconds{detail::day_number_literal<true, Chars...>::nsecs}};
+}
+
+template <char... Chars>
+constexpr tai_clock::time_point operator"" _jd_tai() {
+    return tai_clock::time_point{std::chrono::nanoseconds{detail::day_number_literal<true, Chars...>::nsecs}};
+}
+
+template <char... Chars>
+constexpr tt_clock::time_point operator"" _jd_tt() {
+    return tt_clock::time_point{std::chrono::nanoseconds{detail::day_number_literal<true, Chars...>::nsecs}};
+}
+
+}  // namespace literals
+
+}  // namespace astrochrono
+
+#endif  // ASTROCHRONO_LITERALS_H
@@ -0,0 +1,275 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+#ifndef ASTROCHRONO_MERGE_H
+#define ASTROCHRONO_MERGE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "astrochrono.h"
+
+namespace astrochrono {
+
+namespace detail {
+
+// Identity key of a range of time points
+struct time_point_key {
+    template <typename TimePoint>
+    TimePoint const &operator()(TimePoint const &tp) const noexcept {
+        return tp;
+    }
+};
+
+// Conversion of a sorted sequence of FromClock time points to ToClock nanosecs, looking up the leap
+// second segment only when a time point leaves the current one
+template <typename ToClock, typename FromClock>
+class segment_cast {
+public:
+    std::int64_t operator()(typename FromClock::time_point const &tp) {
+        if (!has_segment_ || tp > segment_.last || tp < segment_.first) {
+            segment_ = find_timescale_segment<ToClock>(tp);
+            has_segment_ = true;
+        }
+        return segment_.is_constant ? (tp.time_since_epoch() + segment_.offset).count()
+                                    : timescale_cast<ToClock>(tp).time_since_epoch().count();
+    }
+
+private:
+    timescale_segment<FromClock> segment_;
+    bool has_segment_ = false;
+};
+
+// Type erased input of timescale_merge
+template <typename ToClock>
+class merge_source_base {
+public:
+    virtual ~merge_source_base() = default;
+
+    // Convert up to n further time points into keys, as TAI nanosecs, and times, as ToClock
+    // nanosecs, returns the number converted
+    virtual std::size_t fill(std::int64_t *keys, std::int64_t *times, std::size_t n) = 0;
+};
+
+template <typename ToClock, typename Iterator, typename Key>
+class merge_source : public merge_source_base<ToClock> {
+public:
+    using from_time_point =
+            typename std::decay<decltype(std::declval<Key const &>()(*std::declval<Iterator>()))>::type;
+    using from_clock = typename from_time_point::clock;
+
+    merge_source(Iterator first, Iterator last, Key key) : first_(first), last_(last), key_(key) {}
+
+    std::size_t fill(std::int64_t *keys, std::int64_t *times, std::size_t n) override {
+        std::size_t i = 0;
+        for (; i < n && first_ != last_; ++i, ++first_) {
+            from_time_point const tp = key_(*first_);
+            keys[i] = to_tai_(tp);
+            times[i] = std::is_same<ToClock, tai_clock>::value ? keys[i] : to_clock_(tp);
+        }
+        return i;
+    }
+
+private:
+    Iterator first_;
+    Iterator last_;
+    Key key_;
+    segment_cast<tai_clock, from_clock> to_tai_;
+    segment_cast<ToClock, from_clock> to_clock_;
+};
+
+}  // namespace detail
+
+/* Streaming k-way merge of sorted ranges of time points on different time scales.
+ *
+ * Every source is a range sorted on its own clock, optionally of events from which a key
+ * function extracts the time point. The merge yields the time points of all sources converted to
+ * ToClock, each with the source it came from and its position in that source, in chronological
+ * order; ties are ordered by source. The order is that of TAI, to which every clock converts
+ * without reordering, so a merge into UTC stays chronological through a leap second where the
+ * UTC time points repeat.
+ *
+ * Every source is converted lazily, buffer_size time points at a time, tracking the leap second
+ * segment it is in so that only time points in a new segment (or in a pre-1972 segment with a
+ * drift term) need a table lookup. The next time point is selected with a loser tree, in
+ * log2(number of sources) comparisons.
+ *
+ *     timescale_merge<tai_clock> merge;
+ *     merge.add_source(instrument.begin(), instrument.end());  // utc_clock::time_point
+ *     merge.add_source(timing.begin(), timing.end(), [](event const &e) { return e.time; });
+ *     timescale_merge<tai_clock>::value_type v;
+ *     while (merge.next(v)) { ... }
+ *
+ * The ranges must outlive the merge. Sources can only be added before the first call to next.
+ */
+template <typename ToClock>
+class timescale_merge {
+public:
+    using clock = ToClock;
+    using time_point = typename ToClock::time_point;
+
+    struct value_type {
+        time_point time;     // time point converted to ToClock
+        std::size_t source;  // index of the source, in the order they were added
+        std::size_t index;   // position in the source
+    };
+
+    explicit timescale_merge(std::size_t buffer_size = 256) : buffer_size_(buffer_size > 0 ? buffer_size : 1) {}
+
+    // Add the sorted range [first, last) of time points and return its source index
+    template <typename Iterator>
+    std::size_t add_source(Iterator first, Iterator last) {
+        return add_source(first, last, detail::time_point_key{});
+    }
+
+    // Add the range [first, last) of values sorted on key(value), a time point, and return its source index
+    template <typename Iterator, typename Key>
+    std::size_t add_source(Iterator first, Iterator last, Key key) {
+        if (started_) {
+            throw std::logic_error("Cannot add a source to a merge in progress");
+        }
+        sources_.emplace_back(new detail::merge_source<ToClock, Iterator, Key>(first, last, key));
+        return sources_.size() - 1;
+    }
+
+    std::size_t sources() const noexcept { return sources_.size(); }
+
+    // Next time point of the merge, false when all sources are exhausted
+    bool next(value_type &out) {
+        if (!started_) {
+            start();
+        }
+        std::size_t const s = tree_.empty() ? 0 : tree_[0];
+        if (tree_.empty() || done_[s]) {
+            return false;
+        }
+        out.time = time_point{std::chrono::nanoseconds{times_[s]}};
+        out.source = s;
+        out.index = consumed_[s]++;
+        advance(s);
+        replay(s);
+        return true;
+    }
+
+    // Write up to n next time points of the merge to out, returns the number written
+    std::size_t next(value_type *out, std::size_t n) {
+        std::size_t i = 0;
+        while (i < n && next(out[i])) {
+            ++i;
+        }
+        return i;
+    }
+
+private:
+    // Whether the current time point of source a goes before that of source b, exhausted sources last
+    bool before(std::size_t a, std::size_t b) const noexcept {
+        if (done_[a] != done_[b]) {
+            return done_[b];
+        }
+        return keys_[a] < keys_[b] || (keys_[a] == keys_[b] && a < b);
+    }
+
+    void start() {
+        started_ = true;
+        std::size_t const k = sources_.size();
+        if (k == 0) {
+            return;
+        }
+        key_buffers_.assign(k * buffer_size_, 0);
+        time_buffers_.assign(k * buffer_size_, 0);
+        positions_.assign(k, 0);
+        sizes_.assign(k, 0);
+        consumed_.assign(k, 0);
+        keys_.assign(k, 0);
+        times_.assign(k, 0);
+        done_.assign(k, false);
+        for (std::size_t s = 0; s < k; ++s) {
+            advance(s);
+        }
+        // nodes 1 .. k-1 hold the loser of their match, leaves k .. 2k-1 stand for the sources
+        tree_.assign(k, 0);
+        std::vector<std::size_t> winners(2 * k);
+        for (std::size_t s = 0; s < k; ++s) {
+            winners[k + s] = s;
+        }
+        for (std::size_t node = k - 1; node > 0; --node) {
+            std::size_t const a = winners[2 * node];
+            std::size_t const b = winners[2 * node + 1];
+            bool const a_wins = before(a, b);
+            winners[node] = a_wins ? a : b;
+            tree_[node] = a_wins ? b : a;
+        }
+        tree_[0] = winners[1];
+    }
+
+    // Load the next key of source s, converting the next buffer of time points when needed
+    void advance(std::size_t s) {
+        if (positions_[s] == sizes_[s]) {
+            sizes_[s] = sources_[s]->fill(key_buffers_.data() + s * buffer_size_,
+                                          time_buffers_.data() + s * buffer_size_, buffer_size_);
+            positions_[s] = 0;
+            if (sizes_[s] == 0) {
+                done_[s] = true;
+                return;
+            }
+        }
+        keys_[s] = key_buffers_[s * buffer_size_ + positions_[s]];
+        times_[s] = time_buffers_[s * buffer_size_ + positions_[s]];
+        ++positions_[s];
+    }
+
+    // Replay the matches of source s from its leaf up to the root
+    void replay(std::size_t s) {
+        std::size_t const k = sources_.size();
+        std::size_t winner = s;
+        for (std::size_t node = (k + s) / 2; node > 0; node /= 2) {
+            if (before(tree_[node], winner)) {
+                std::swap(tree_[node], winner);
+            }
+        }
+        tree_[0] = winner;
+    }
+
+    std::size_t buffer_size_;
+    bool started_ = false;
+    std::vector<std::unique_ptr<detail::merge_source_base<ToClock>>> sources_;
+    std::vector<std::int64_t> key_buffers_;   // buffer_size_ TAI nanosecs per source
+    std::vector<std::int64_t> time_buffers_;  // buffer_size_ ToClock nanosecs per source
+    std::vector<std::size_t> positions_;
+    std::vector<std::size_t> sizes_;
+    std::vector<std::size_t> consumed_;
+    std::vector<std::int64_t> keys_;   // current time point of each source in TAI
+    std::vector<std::int64_t> times_;  // and in ToClock
+    std::vector<bool> done_;
+    std::vector<std::size_t> tree_;  // winner at 0, losers at 1 .. k-1
+};
+
+}  // namespace astrochrono
+
+#endif  // ASTROCHRONO_MERGE_H
@@ -0,0 +1,363 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef ASTROCHRONO_PARSE_H
+#define ASTROCHRONO_PARSE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "astrochrono.h"
+
+namespace astrochrono {
+
+// Timestamp representations recognized by timestamp_parser
+enum class timestamp_format {
+    unknown,
+    iso8601_extended,  // 2017-01-01T00:00:00.5Z, also FITS DATE-OBS (2017-01-01T00:00:00.5 or 2017-01-01)
+    iso8601_basic,     // 20170101T000000.5Z, or a date alone (20170101)
+    mjd,               // decimal number with at most 6 integer digits
+    jd,                // decimal number with 7 integer digits
+    unix_seconds       // decimal number with 8 or more integer digits, seconds since 1970 in UTC,
+                       // except 8 digits without a fraction that form a valid basic date
+};
+
+// Nanoseconds since the epoch of a decoded timestamp, on UTC if is_utc (a "Z" suffix or Unix
+// seconds) and otherwise on the time scale of the clock it is parsed for
+struct decoded_timestamp {
+    std::int64_t nsecs;
+    bool is_utc;
+};
+
+namespace detail {
+
+constexpr bool is_digit(char c) noexcept { return c >= '0' && c <= '9'; }
+
+constexpr std::size_t count_digits(const char* p, const char* last) noexcept {
+    std::size_t n = 0;
+    while (p + n != last && is_digit(p[n])) {
+        ++n;
+    }
+    return n;
+}
+
+// Read exactly n decimal digits
+constexpr bool read_digits(const char*& p, const char* last, int n, std::int64_t& value) noexcept {
+    if (last - p < n) {
+        return false;
+    }
+    std::int64_t v = 0;
+    for (int i = 0; i < n; ++i) {
+        if (!is_digit(p[i])) {
+            return false;
+        }
+        v = v * 10 + (p[i] - '0');
+    }
+    p += n;
+    value = v;
+    return true;
+}
+
+// Read the digits of a fraction as a multiple of unit = mantissa * 10^exponent nanoseconds,
+// truncated to the nanosecond as in from_string. Digits beyond the 15th are ignored.
+constexpr std::int64_t read_fraction(const char*& p, const char* last, std::int64_t mantissa,
+                                     int exponent) noexcept {
+    std::int64_t f = 0;
+    int digits = 0;
+    for (; p != last && is_digit(*p); ++p) {
+        if (digits < 15) {
+            f = f * 10 + (*p - '0');
+            ++digits;
+        }
+    }
+    std::int64_t const scaled = f * mantissa;
+    if (digits <= exponent) {
+        return scaled * power_of_10(exponent - digits);
+    }
+    return scaled / power_of_10(digits - exponent);
+}
+
+// Read the three fields of an ISO 8601 date or time, the first one width digits wide and the
+// others two, separated by separator in the extended form
+constexpr bool read_triple(const char*& p, const char* last, bool extended, char separator, int width,
+                           std::int64_t& a, std::int64_t& b, std::int64_t& c) noexcept {
+    if (!read_digits(p, last, width, a)) {
+        return false;
+    }
+    for (std::int64_t* field : {&b, &c}) {
+        if (extended && (p == last || *p++ != separator)) {
+            return false;
+        }
+        if (!read_digits(p, last, 2, *field)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Nanoseconds of days days since the epoch plus nsec_of_day, false outside the time_point range
+constexpr bool checked_nsecs(std::int64_t days, std::int64_t nsec_of_day, std::int64_t& nsecs) noexcept {
+    if (days < MIN_EPOCH_DAYS || days > MAX_EPOCH_DAYS) {
+        return false;
+    }
+    nsecs = days * NSEC_PER_DAY + nsec_of_day;
+    return true;
+}
+
+// Decimal number of units (mantissa * 10^exponent nanoseconds) as a whole and a fractional part,
+// the fraction in nanoseconds in [0, unit)
+constexpr bool read_decimal(const char* p, const char* last, std::size_t max_digits, std::int64_t mantissa,
+                            int exponent, std::int64_t& whole, std::int64_t& fraction) noexcept {
+    bool negative = false;
+    if (p != last && (*p == '-' || *p == '+')) {
+        negative = *p++ == '-';
+    }
+    std::size_t const n = count_digits(p, last);
+    if (n == 0 || n > max_digits) {
+        return false;
+    }
+    std::int64_t w = 0;
+    read_digits(p, last, static_cast<int>(n), w);
+    std::int64_t f = 0;
+    if (p != last && *p == '.') {
+        ++p;
+        f = read_fraction(p, last, mantissa, exponent);
+    }
+    if (p != last) {
+        return false;
+    }
+    std::int64_t const unit = mantissa * power_of_10(exponent);
+    if (negative && f != 0) {
+        w = -w - 1;
+        f = unit - f;
+    } else if (negative) {
+        w = -w;
+    }
+    whole = w;
+    fraction = f;
+    return true;
+}
+
+// Whether the 8 digits at p form a valid ISO 8601 basic date YYYYMMDD
+constexpr bool is_basic_date(const char* p) noexcept {
+    std::int64_t date = 0;
+    read_digits(p, p + 8, 8, date);
+    auto const month = static_cast<unsigned>(date / 100 % 100);
+    auto const day = static_cast<unsigned>(date % 100);
+    return month >= 1 && month <= 12 && day >= 1 && day <= days_in_month(date / 10000, month);
+}
+
+}  // namespace detail
+
+// Representation of the timestamp [first, last), judged from its leading characters only.
+// Eight digits alone are a basic date when they form a valid one, so 20170101 is 2017-01-01
+// rather than 1970-08-22 in Unix seconds.
+constexpr timestamp_format sniff_timestamp(const char* first, const char* last) noexcept {
+    const char* p = first;
+    bool const has_sign = p != last && (*p == '-' || *p == '+');
+    p += has_sign;
+    std::size_t const n = detail::count_digits(p, last);
+    const char* const next = p + n;
+    if (n == 0) {
+        return timestamp_format::unknown;
+    }
+    if (!has_sign && n == 4 && next != last && *next == '-') {
+        return timestamp_format::iso8601_extended;
+    }
+    if (!has_sign && n == 8 && (next == last ? detail::is_basic_date(p) : *next == 'T')) {
+        return timestamp_format::iso8601_basic;
+    }
+    if (next == last || *next == '.') {
+        if (n <= 6) {
+            return timestamp_format::mjd;
+        }
+        return n == 7 ? timestamp_format::jd : timestamp_format::unix_seconds;
+    }
+    return timestamp_format::unknown;
+}
+
+// Decode an ISO 8601 date and time in extended (with separators) or basic form, with an optional
+// fraction of a second and an optional "Z" suffix, or a date alone.
+constexpr bool decode_iso8601(const char* first, const char* last, bool extended,
+                              decoded_timestamp& out) noexcept {
+    const char* p = first;
+    std::int64_t year = 0;
+    std::int64_t month = 0;
+    std::int64_t day = 0;
+    std::int64_t hour = 0;
+    std::int64_t minute = 0;
+    std::int64_t second = 0;
+    std::int64_t nsec = 0;
+    bool is_utc = false;
+    if (!detail::read_triple(p, last, extended, '-', 4, year, month, day)) {
+        return false;
+    }
+    if (p != last) {
+        if (*p++ != 'T' ||
+            !detail::read_triple(p, last, extended, ':', 2, hour, minute, second)) {
+            return false;
+        }
+        if (p != last && (*p == '.' || *p == ',')) {
+            ++p;
+            if (p == last || !detail::is_digit(*p)) {
+                return false;
+            }
+            nsec = detail::read_fraction(p, last, 1, 9);
+        }
+        if (p != last && *p == 'Z') {
+            ++p;
+            is_utc = true;
+        }
+        if (p != last) {
+            return false;
+        }
+    }
+    auto const m = static_cast<unsigned>(month);
+    auto const d = static_cast<unsigned>(day);
+    if (m < 1 || m > 12 || d < 1 || d > detail::days_in_month(year, m) || hour > 23 || minute > 59 ||
+        second > 60) {
+        return false;
+    }
+    // A leap second label (second == 60) normalizes to the next minute, as in from_calendar
+    std::int64_t const days = detail::days_from_civil(year, m, d);
+    std::int64_t const nsec_of_day = ((hour * 60 + minute) * 60 + second) * detail::NSEC_PER_SEC + nsec;
+    out.is_utc = is_utc;
+    return detail::checked_nsecs(days, nsec_of_day, out.nsecs);
+}
+
+// Decode a decimal Modified Julian Date
+constexpr bool decode_mjd(const char* first, const char* last, decoded_timestamp& out) noexcept {
+    std::int64_t day = 0;
+    std::int64_t nsec_of_day = 0;
+    out.is_utc = false;
+    return detail::read_decimal(first, last, 7, 864, 11, day, nsec_of_day) &&
+           detail::checked_nsecs(day - detail::EPOCH_MJD, nsec_of_day, out.nsecs);
+}
+
+// Decode a decimal Julian Date
+constexpr bool decode_jd(const char* first, const char* last, decoded_timestamp& out) noexcept {
+    std::int64_t day = 0;
+    std::int64_t nsec_of_day = 0;
+    out.is_utc = false;
+    // Julian days start at noon
+    return detail::read_decimal(first, last, 8, 864, 11, day, nsec_of_day) &&
+           detail::checked_nsecs(day - detail::EPOCH_MJD - 2400001, nsec_of_day + detail::NSEC_PER_DAY / 2,
+                                 out.nsecs);
+}
+
+// Decode decimal seconds since 1970-01-01T00:00:00Z (Unix time, which ignores leap seconds)
+constexpr bool decode_unix_seconds(const char* first, const char* last, decoded_timestamp& out) noexcept {
+    std::int64_t seconds = 0;
+    std::int64_t nsec = 0;
+    out.is_utc = true;
+    // 11 digits are enough for the whole time_point range, check that range in whole days
+    return detail::read_decimal(first, last, 11, 1, 9, seconds, nsec) &&
+           detail::checked_nsecs(detail::floor_div(seconds, 86400),
+                                 detail::floor_mod(seconds, 86400) * detail::NSEC_PER_SEC + nsec, out.nsecs);
+}
+
+constexpr bool decode_timestamp(timestamp_format format, const char* first, const char* last,
+                                decoded_timestamp& out) noexcept {
+    switch (format) {
+        case timestamp_format::iso8601_extended:
+            return decode_iso8601(first, last, true, out);
+        case timestamp_format::iso8601_basic:
+            return decode_iso8601(first, last, false, out);
+        case timestamp_format::mjd:
+            return decode_mjd(first, last, out);
+        case timestamp_format::jd:
+            return decode_jd(first, last, out);
+        case timestamp_format::unix_seconds:
+            return decode_unix_seconds(first, last, out);
+        default:
+            return false;
+    }
+}
+
+/* Parser for columns of timestamps in any of the representations of timestamp_format.
+ *
+ * Every timestamp is sniffed from its leading characters and decoded without allocation or
+ * exceptions. Timestamps with a "Z" suffix or in Unix seconds are UTC and are converted to Clock,
+ * all others (including MJD and JD) are taken to be on the time scale of Clock.
+ *
+ * For homogeneous columns, a parser constructed with lock_after > 0 stops sniffing once that many
+ * consecutive timestamps had the same representation, and from then on only accepts that one.
+ */
+template <typename Clock>
+class timestamp_parser {
+public:
+    using clock = Clock;
+    using time_point = typename Clock::time_point;
+
+    explicit timestamp_parser(std::size_t lock_after = 0) noexcept : lock_after_(lock_after) {}
+
+    // Parse [first, last), returns false if it is not a timestamp or out of range
+    bool parse(const char* first, const char* last, time_point& tp) {
+        timestamp_format const format = locked_ ? format_ : sniff_timestamp(first, last);
+        decoded_timestamp decoded{0, false};
+        if (!decode_timestamp(format, first, last, decoded)) {
+            return false;
+        }
+        if (!locked_) {
+            run_ = format == format_ ? run_ + 1 : 1;
+            format_ = format;
+            locked_ = lock_after_ > 0 && run_ >= lock_after_;
+        }
+        std::chrono::nanoseconds const nsecs{decoded.nsecs};
+        if (!decoded.is_utc) {
+            tp = time_point{nsecs};
+            return true;
+        }
+        try {
+            tp = timescale_cast<Clock>(utc_clock::time_point{nsecs});
+        } catch (std::domain_error const&) {
+            return false;
+        }
+        return true;
+    }
+
+    time_point parse(std::string const& str) {
+        time_point tp;
+        if (!parse(str.data(), str.data() + str.size(), tp)) {
+            throw std::invalid_argument("Not a recognized timestamp: " + str);
+        }
+        return tp;
+    }
+
+    // Representation of the last parsed timestamp, or the locked one
+    timestamp_format format() const noexcept { return format_; }
+
+    bool locked() const noexcept { return locked_; }
+
+private:
+    std::size_t lock_after_;
+    std::size_t run_ = 0;
+    timestamp_format format_ = timestamp_format::unknown;
+    bool locked_ = false;
+};
+
+}  // namespace astrochrono
+
+#endif  // ASTROCHRONO_PARSE_H
@@ -0,0 +1,399 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+#include "astrochrono_trace.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <istream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+
+namespace astrochrono {
+
+namespace detail {
+
+thread_local trace_ring *current_trace_ring = nullptr;
+
+// Simultaneous readings of the trace counter and of the system clock (UTC nanosecs)
+struct trace_anchor {
+    std::uint64_t counter;
+    std::int64_t utc;
+};
+
+// Read the system clock between two counter readings, keeping the tightest of a few attempts
+trace_anchor take_anchor() {
+    trace_anchor anchor{0, 0};
+    std::uint64_t width = std::numeric_limits<std::uint64_t>::max();
+    for (int i = 0; i < 8; ++i) {
+        struct timespec ts;
+        std::uint64_t const before = trace_counter();
+        clock_gettime(CLOCK_REALTIME, &ts);
+        std::uint64_t const after = trace_counter();
+        if (after - before < width) {
+            width = after - before;
+            anchor.counter = before + width / 2;
+            anchor.utc = static_cast<std::int64_t>(ts.tv_sec) * NSEC_PER_SEC + ts.tv_nsec;
+        }
+    }
+    return anchor;
+}
+
+// TAI nanosecs of an anchor
+std::int64_t tai_nsecs(trace_anchor const &anchor) {
+    return timescale_cast<tai_clock>(utc_clock::time_point{std::chrono::nanoseconds{anchor.utc}})
+            .time_since_epoch()
+            .count();
+}
+
+namespace {
+
+constexpr char TRACE_MAGIC[8] = {'A', 'C', 'T', 'R', 'A', 'C', 'E', '1'};
+
+constexpr std::size_t DEFAULT_TRACE_BUFFER_SIZE = std::size_t{1} << 16;
+
+// Marks the ring of a thread as finished when the thread exits
+struct trace_thread_exit {
+    trace_ring *ring = nullptr;
+    ~trace_thread_exit();
+};
+
+thread_local bool trace_thread_exited = false;
+
+}  // namespace
+
+struct trace_registry {
+    std::mutex mutex;
+    std::vector<std::string> events;
+    std::map<std::string, trace_event> ids;
+    std::vector<std::unique_ptr<trace_ring>> rings;
+    std::size_t capacity = DEFAULT_TRACE_BUFFER_SIZE;
+    std::uint32_t threads = 0;
+    trace_anchor const origin = take_anchor();
+
+    // Never destroyed, threads may still record while static objects are destroyed
+    static trace_registry &instance() {
+        static trace_registry *registry = new trace_registry;
+        return *registry;
+    }
+
+    // Create the ring of a new thread
+    trace_ring *add_ring() {
+        std::lock_guard<std::mutex> lock(mutex);
+        rings.emplace_back(new trace_ring(capacity));
+        trace_ring *ring = rings.back().get();
+        ring->thread_ = threads++;
+        return ring;
+    }
+
+    // Append the records of all rings since the previous dump and release the rings of exited
+    // threads, with the mutex held. Returns the number of records lost to overwriting.
+    std::uint64_t drain(std::vector<std::uint64_t> &counters, std::vector<std::uint64_t> &events,
+                        std::vector<std::uint32_t> &thread_ids) {
+        std::uint64_t dropped = 0;
+        auto it = rings.begin();
+        while (it != rings.end()) {
+            trace_ring &ring = **it;
+            // after the thread has finished the records below are its last ones
+            bool const finished = ring.finished_.load(std::memory_order_acquire);
+            dropped += drain(ring, finished, counters, events);
+            thread_ids.resize(counters.size(), ring.thread_);
+            it = finished ? rings.erase(it) : it + 1;
+        }
+        return dropped;
+    }
+
+    static void finish(trace_ring *ring) noexcept { ring->finished_.store(true, std::memory_order_release); }
+
+    // Append the records of ring since the previous dump as (counter, packed event) pairs,
+    // returns the number of records lost to overwriting
+    static std::uint64_t drain(trace_ring &ring, bool finished, std::vector<std::uint64_t> &counters,
+                               std::vector<std::uint64_t> &events) {
+        std::uint64_t const capacity = ring.capacity();
+        std::uint64_t const head = ring.head_.load(std::memory_order_acquire);
+        std::uint64_t const first = std::max(ring.tail_, head > capacity ? head - capacity : 0);
+        std::size_t const start = counters.size();
+        for (std::uint64_t i = first; i < head; ++i) {
+            counters.push_back(ring.counters_[i & ring.mask_].load(std::memory_order_relaxed));
+            events.push_back(ring.events_[i & ring.mask_].load(std::memory_order_relaxed));
+        }
+        // records the thread has overwritten or may be overwriting meanwhile are torn, drop them
+        std::atomic_thread_fence(std::memory_order_acquire);
+        std::uint64_t const now = ring.head_.load(std::memory_order_relaxed) + (finished ? 0 : 1);
+        std::uint64_t const valid = now > capacity ? now - capacity : 0;
+        std::size_t const torn = valid > first ? static_cast<std::size_t>(std::min(valid, head) - first) : 0;
+        counters.erase(counters.begin() + start, counters.begin() + start + torn);
+        events.erase(events.begin() + start, events.begin() + start + torn);
+        std::uint64_t const dropped = first - ring.tail_ + torn;
+        ring.tail_ = head;
+        return dropped;
+    }
+};
+
+trace_thread_exit::~trace_thread_exit() {
+    current_trace_ring = nullptr;
+    trace_thread_exited = true;
+    if (ring != nullptr) {
+        trace_registry::finish(ring);
+    }
+}
+
+trace_ring *register_trace_thread() noexcept {
+    // a thread that records while its thread_local objects are destroyed is not traced
+    if (trace_thread_exited) {
+        return nullptr;
+    }
+    try {
+        static thread_local trace_thread_exit exit;
+        trace_ring *ring = trace_registry::instance().add_ring();
+        exit.ring = ring;
+        current_trace_ring = ring;
+        return ring;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+namespace {
+
+void put_u32(std::ostream &os, std::uint32_t v) {
+    char bytes[4];
+    for (int i = 0; i < 4; ++i) {
+        bytes[i] = static_cast<char>(v >> (8 * i));
+    }
+    os.write(bytes, 4);
+}
+
+void put_u64(std::ostream &os, std::uint64_t v) {
+    char bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = static_cast<char>(v >> (8 * i));
+    }
+    os.write(bytes, 8);
+}
+
+void get_bytes(std::istream &is, char *bytes, std::size_t n) {
+    if (!is.read(bytes, static_cast<std::streamsize>(n))) {
+        throw std::runtime_error("Truncated trace");
+    }
+}
+
+std::uint32_t get_u32(std::istream &is) {
+    unsigned char bytes[4];
+    get_bytes(is, reinterpret_cast<char *>(bytes), 4);
+    std::uint32_t v = 0;
+    for (int i = 3; i >= 0; --i) {
+        v = v << 8 | bytes[i];
+    }
+    return v;
+}
+
+std::uint64_t get_u64(std::istream &is) {
+    unsigned char bytes[8];
+    get_bytes(is, reinterpret_cast<char *>(bytes), 8);
+    std::uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) {
+        v = v << 8 | bytes[i];
+    }
+    return v;
+}
+
+const char *phase_name(trace_phase phase) {
+    switch (phase) {
+        case trace_phase::begin:
+            return "begin";
+        case trace_phase::end:
+            return "end";
+        default:
+            return "instant";
+    }
+}
+
+void put_json_string(std::ostream &os, std::string const &s) {
+    static const char hex[] = "0123456789abcdef";
+    os << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            os << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+}  // namespace
+
+}  // namespace detail
+
+trace_event register_trace_event(std::string const &name) {
+    detail::trace_registry &registry = detail::trace_registry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto const it = registry.ids.find(name);
+    if (it != registry.ids.end()) {
+        return it->second;
+    }
+    trace_event const id = static_cast<trace_event>(registry.events.size());
+    registry.events.push_back(name);
+    registry.ids.emplace(name, id);
+    return id;
+}
+
+void set_trace_buffer_size(std::size_t records) {
+    std::size_t capacity = 1;
+    while (capacity < records) {
+        capacity *= 2;
+    }
+    detail::trace_registry &registry = detail::trace_registry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.capacity = capacity;
+}
+
+trace_dump dump_trace() {
+    detail::trace_registry &registry = detail::trace_registry::instance();
+    trace_dump dump;
+    std::vector<std::uint64_t> counters;
+    std::vector<std::uint64_t> events;
+    std::vector<std::uint32_t> threads;
+    detail::trace_anchor origin, anchor;
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        dump.events = registry.events;
+        dump.dropped = registry.drain(counters, events, threads);
+        origin = registry.origin;
+        anchor = detail::take_anchor();
+    }
+
+    // counters to TAI by linear interpolation between the two anchors, which are converted to TAI
+    // first so that a leap second between them is accounted for
+    std::int64_t const first = tai_nsecs(origin);
+    std::int64_t const last = tai_nsecs(anchor);
+    std::int64_t const counts = static_cast<std::int64_t>(anchor.counter - origin.counter);
+    double const nsecs_per_count = counts > 0 ? static_cast<double>(last - first) / counts : 1.0;
+    std::size_t const n = counters.size();
+    std::vector<tai_clock::time_point> tai(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        double const elapsed = static_cast<std::int64_t>(counters[i] - origin.counter) * nsecs_per_count;
+        tai[i] = tai_clock::time_point{std::chrono::nanoseconds{first + std::llround(elapsed)}};
+    }
+
+    dump.records.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        dump.records[i] = trace_record{tai[i], threads[i], static_cast<trace_event>(events[i]),
+                                       static_cast<trace_phase>(events[i] >> 32)};
+    }
+    // the records of each thread are in order already
+    std::stable_sort(dump.records.begin(), dump.records.end(),
+                     [](trace_record const &a, trace_record const &b) { return a.time < b.time; });
+    return dump;
+}
+
+void write_trace(std::ostream &os, trace_dump const &dump) {
+    os.write(detail::TRACE_MAGIC, sizeof(detail::TRACE_MAGIC));
+    detail::put_u32(os, static_cast<std::uint32_t>(dump.events.size()));
+    for (auto const &name : dump.events) {
+        detail::put_u32(os, static_cast<std::uint32_t>(name.size()));
+        os.write(name.data(), static_cast<std::streamsize>(name.size()));
+    }
+    detail::put_u64(os, dump.dropped);
+    detail::put_u64(os, dump.records.size());
+    for (auto const &r : dump.records) {
+        detail::put_u64(os, static_cast<std::uint64_t>(r.time.time_since_epoch().count()));
+        detail::put_u32(os, r.thread);
+        detail::put_u32(os, r.event);
+        detail::put_u32(os, static_cast<std::uint32_t>(r.phase));
+    }
+}
+
+trace_dump read_trace(std::istream &is) {
+    char magic[sizeof(detail::TRACE_MAGIC)];
+    if (!is.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), detail::TRACE_MAGIC)) {
+        throw std::runtime_error("Not an astrochrono trace");
+    }
+    trace_dump dump;
+    dump.events.resize(detail::get_u32(is));
+    for (auto &name : dump.events) {
+        name.resize(detail::get_u32(is));
+        detail::get_bytes(is, &name[0], name.size());
+    }
+    dump.dropped = detail::get_u64(is);
+    std::uint64_t const n = detail::get_u64(is);
+    for (std::uint64_t i = 0; i < n; ++i) {
+        trace_record r;
+        r.time = tai_clock::time_point{std::chrono::nanoseconds{static_cast<std::int64_t>(detail::get_u64(is))}};
+        r.thread = detail::get_u32(is);
+        r.event = detail::get_u32(is);
+        std::uint32_t const phase = detail::get_u32(is);
+        if (r.event >= dump.events.size() || phase > static_cast<std::uint32_t>(trace_phase::end)) {
+            throw std::runtime_error("Corrupt trace record");
+        }
+        r.phase = static_cast<trace_phase>(phase);
+        dump.records.push_back(r);
+    }
+    return dump;
+}
+
+void write_trace_text(std::ostream &os, trace_dump const &dump) {
+    os << "# time (TAI)\tthread\tphase\tevent\n";
+    for (auto const &r : dump.records) {
+        os << to_string(r.time) << '\t' << r.thread << '\t' << detail::phase_name(r.phase) << '\t'
+           << dump.events.at(r.event) << '\n';
+    }
+    if (dump.dropped != 0) {
+        os << "# " << dump.dropped << " records dropped\n";
+    }
+}
+
+void write_trace_chrome(std::ostream &os, trace_dump const &dump) {
+    std::int64_t const origin = dump.records.empty() ? 0 : dump.records.front().time.time_since_epoch().count();
+    os << "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"origin\":\"";
+    if (!dump.records.empty()) {
+        os << to_string(dump.records.front().time) << " TAI";
+    }
+    os << "\",\"dropped\":" << dump.dropped << "},\"traceEvents\":[";
+    static const char *const phases[] = {"i", "B", "E"};
+    for (std::size_t i = 0; i < dump.records.size(); ++i) {
+        trace_record const &r = dump.records[i];
+        // microseconds with exactly three decimals, a double would lose nanoseconds
+        std::int64_t const nsecs = r.time.time_since_epoch().count() - origin;
+        char fraction[4] = {static_cast<char>('0' + nsecs / 100 % 10), static_cast<char>('0' + nsecs / 10 % 10),
+                            static_cast<char>('0' + nsecs % 10), '\0'};
+        os << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+        detail::put_json_string(os, dump.events.at(r.event));
+        os << ",\"ph\":\"" << phases[static_cast<std::uint32_t>(r.phase)] << '"';
+        if (r.phase == trace_phase::instant) {
+            os << ",\"s\":\"t\"";
+        }
+        os << ",\"ts\":" << nsecs / 1000 << '.' << fraction << ",\"pid\":0,\"tid\":" << r.thread << '}';
+    }
+    os << "\n]}\n";
+}
+
+}  // namespace astrochrono
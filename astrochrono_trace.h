@@ -0,0 +1,192 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+#ifndef ASTROCHRONO_TRACE_H
+#define ASTROCHRONO_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "astrochrono.h"
+
+namespace astrochrono {
+
+/* Low overhead tracing with TAI time stamps.
+ *
+ * Every thread records (event, raw counter) pairs into its own lock-free ring buffer, recording
+ * an event costs a counter read and two stores. The counter (the time stamp counter on x86, the
+ * steady clock elsewhere) is converted to TAI only when the trace is dumped: the system clock is
+ * read together with the counter when tracing starts and again at the dump, both anchors are
+ * converted to TAI, and the counters are interpolated linearly between them. The counter ticks
+ * uniformly like TAI, so a leap second between the anchors needs no per record conversion. When a
+ * ring is full the oldest records are overwritten, dump_trace reports how many were lost.
+ *
+ *     static trace_event const read_event = register_trace_event("read");
+ *     {
+ *         ASTROCHRONO_TRACE_SCOPE(read_event);
+ *         ...
+ *     }
+ *     write_trace(file, dump_trace());
+ *
+ * Defining ASTROCHRONO_DISABLE_TRACE compiles the ASTROCHRONO_TRACE macros to nothing.
+ */
+
+using trace_event = std::uint32_t;
+
+enum class trace_phase : std::uint32_t { instant = 0, begin = 1, end = 2 };
+
+struct trace_record {
+    tai_clock::time_point time;
+    std::uint32_t thread;  // threads are numbered in the order of their first record
+    trace_event event;
+    trace_phase phase;
+};
+
+struct trace_dump {
+    std::vector<std::string> events;   // names, indexed by trace_event
+    std::vector<trace_record> records;  // sorted by time
+    std::uint64_t dropped = 0;          // records overwritten before they could be dumped
+};
+
+// Id of the event with the given name, the same name always gives the same id
+trace_event register_trace_event(std::string const &name);
+
+// Capacity of the ring buffers of threads that record their first event afterwards,
+// rounded up to a power of two (65536 records of 16 bytes by default)
+void set_trace_buffer_size(std::size_t records);
+
+// Records of all threads since the previous dump, converted to TAI.
+// Buffers of threads that have exited are released once they have been dumped.
+trace_dump dump_trace();
+
+// Binary dump: the magic "ACTRACE1", the event names and the records, all integers little endian
+void write_trace(std::ostream &os, trace_dump const &dump);
+
+// Read a binary dump, throws std::runtime_error if the stream does not hold one
+trace_dump read_trace(std::istream &is);
+
+// One line per record: TAI time stamp, thread, phase and event name
+void write_trace_text(std::ostream &os, trace_dump const &dump);
+
+// Chrome trace event JSON (chrome://tracing, Perfetto), time stamps in microseconds since the
+// first record, whose TAI time stamp is stored in otherData.origin
+void write_trace_chrome(std::ostream &os, trace_dump const &dump);
+
+namespace detail {
+
+// Raw time stamp counter, converted to time at dump time
+inline std::uint64_t trace_counter() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+struct trace_registry;
+
+// Single producer ring, written by its thread and read by dump_trace
+class trace_ring {
+public:
+    explicit trace_ring(std::size_t capacity)
+            : mask_(capacity - 1), counters_(new std::atomic<std::uint64_t>[capacity]),
+              events_(new std::atomic<std::uint64_t>[capacity]) {}
+
+    void push(std::uint64_t counter, std::uint64_t event) noexcept {
+        std::uint64_t const head = head_.load(std::memory_order_relaxed);
+        // a dump that sees the overwritten slot also sees the head that invalidates it
+        std::atomic_thread_fence(std::memory_order_release);
+        counters_[head & mask_].store(counter, std::memory_order_relaxed);
+        events_[head & mask_].store(event, std::memory_order_relaxed);
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    std::size_t capacity() const noexcept { return mask_ + 1; }
+
+private:
+    friend struct trace_registry;
+
+    std::uint64_t const mask_;
+    std::atomic<std::uint64_t> head_{0};  // number of records pushed
+    std::uint64_t tail_ = 0;              // number of records dumped, owned by the dump
+    std::atomic<bool> finished_{false};   // set when the thread exits
+    std::uint32_t thread_ = 0;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> counters_;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> events_;
+};
+
+// Ring of the calling thread, nullptr before its first record
+extern thread_local trace_ring *current_trace_ring;
+
+// Create and register the ring of the calling thread, nullptr if that fails
+trace_ring *register_trace_thread() noexcept;
+
+}  // namespace detail
+
+// Record event in the ring of the calling thread
+inline void trace(trace_event event, trace_phase phase = trace_phase::instant) noexcept {
+    detail::trace_ring *ring = detail::current_trace_ring;
+    if (ring == nullptr && (ring = detail::register_trace_thread()) == nullptr) {
+        return;
+    }
+    ring->push(detail::trace_counter(), static_cast<std::uint64_t>(phase) << 32 | event);
+}
+
+// Records the begin of event on construction and its end on destruction
+class trace_scope {
+public:
+    explicit trace_scope(trace_event event) noexcept : event_(event) { trace(event_, trace_phase::begin); }
+    ~trace_scope() { trace(event_, trace_phase::end); }
+
+    trace_scope(trace_scope const &) = delete;
+    trace_scope &operator=(trace_scope const &) = delete;
+
+private:
+    trace_event event_;
+};
+
+}  // namespace astrochrono
+
+#define ASTROCHRONO_TRACE_CONCAT_(a, b) a##b
+#define ASTROCHRONO_TRACE_CONCAT(a, b) ASTROCHRONO_TRACE_CONCAT_(a, b)
+
+#ifdef ASTROCHRONO_DISABLE_TRACE
+#define ASTROCHRONO_TRACE(event) ((void)0)
+#define ASTROCHRONO_TRACE_SCOPE(event) ((void)0)
+#else
+#define ASTROCHRONO_TRACE(event) ::astrochrono::trace(event)
+#define ASTROCHRONO_TRACE_SCOPE(event) \
+    ::astrochrono::trace_scope ASTROCHRONO_TRACE_CONCAT(astrochrono_trace_scope_, __LINE__)(event)
+#endif
+
+#endif  // ASTROCHRONO_TRACE_H
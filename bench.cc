@@ -0,0 +1,484 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+// Benchmarks of the array conversions, build with -DASTROCHRONO_WITH_BENCHMARKS=ON
+// and -DCMAKE_BUILD_TYPE=Release and run as
+//
+//     benchmark [number of elements, default 10^8]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "astrochrono.h"
+#include "astrochrono_barycentric.h"
+#include "astrochrono_binning.h"
+#include "astrochrono_chrono.h"
+#include "astrochrono_column.h"
+#include "astrochrono_interval.h"
+#include "astrochrono_leap.h"
+#include "astrochrono_merge.h"
+#include "astrochrono_parse.h"
+#include "astrochrono_trace.h"
+
+using namespace astrochrono;
+
+namespace {
+
+// Run f a few times and print its best throughput
+template <typename F>
+void measure(std::string const &name, std::size_t n, F f) {
+    std::chrono::duration<double> elapsed = std::chrono::hours{1};
+    for (int run = 0; run < 3; ++run) {
+        auto const start = std::chrono::steady_clock::now();
+        f();
+        elapsed = std::min<std::chrono::duration<double>>(elapsed, std::chrono::steady_clock::now() - start);
+    }
+    std::cout << std::left << std::setw(40) << name << std::right << std::setw(10) << std::fixed
+              << std::setprecision(3) << elapsed.count() << " s" << std::setw(10) << std::setprecision(3)
+              << n / elapsed.count() / 1e6 << " M/s" << std::endl;
+}
+
+// Keep results observable so the measured loops are not optimized away
+template <typename T>
+void consume(std::vector<T> const &v) {
+    volatile char sink = *reinterpret_cast<char const *>(&v[v.size() / 2]);
+    (void)sink;
+}
+
+void bench_mjd(std::size_t n) {
+    std::vector<tai_clock::time_point> tps(n);
+    auto const t0 = tai_clock::from_string("2020-01-01T00:00:00");
+    for (std::size_t i = 0; i < n; ++i) {
+        tps[i] = t0 + std::chrono::nanoseconds{static_cast<std::int64_t>(i) * 1234567};
+    }
+    std::vector<double> mjd(n);
+    std::vector<split_days> split(n);
+    std::vector<tai_clock::time_point> back(n);
+    std::vector<std::uint8_t> mask(n);
+
+    measure("to_mjd scalar", n, [&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            mjd[i] = to_mjd(tps[i]).count();
+        }
+    });
+    consume(mjd);
+    measure("to_mjd array (double)", n, [&] { to_mjd(tps.data(), n, mjd.data()); });
+    consume(mjd);
+    measure("to_mjd array (split_days)", n, [&] { to_mjd(tps.data(), n, split.data()); });
+    consume(split);
+    measure("to_jd array (double)", n, [&] { to_jd(tps.data(), n, mjd.data()); });
+    consume(mjd);
+
+    to_mjd(tps.data(), n, mjd.data());
+    measure("from_mjd scalar", n, [&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            back[i] = tai_clock::from_mjd(days{mjd[i]});
+        }
+    });
+    consume(back);
+    measure("from_mjd array (double)", n, [&] { from_mjd<tai_clock>(mjd.data(), n, back.data(), mask.data()); });
+    consume(back);
+    measure("from_mjd array (split_days)", n,
+            [&] { from_mjd<tai_clock>(split.data(), n, back.data(), mask.data()); });
+    consume(back);
+}
+
+// The double based drift evaluation that the fixed point leap table replaced, as a baseline
+struct double_leap {
+    std::int64_t when_utc;
+    std::int64_t when_tai;
+    double offset;   // TAI - UTC in seconds
+    double mjd_ref;  // intercept of the MJD interpolation
+    double drift;    // seconds per day
+};
+
+std::vector<double_leap> double_leap_table() {
+    std::vector<double_leap> table;
+    for (auto const &e : detail::leap_seconds) {
+        double_leap l;
+        l.when_utc = detail::leap_when_utc(e);
+        l.offset = e.offset_ns * 1.0e-9;
+        l.mjd_ref = static_cast<double>(e.ref_mjd);
+        l.drift = e.drift_ns * 1.0e-9;
+        l.when_tai = l.when_utc +
+                     static_cast<std::int64_t>(1.0e9 * (l.offset + (e.mjd - l.mjd_ref) * l.drift));
+        table.push_back(l);
+    }
+    return table;
+}
+
+std::int64_t double_utc_to_tai(std::vector<double_leap> const &table, utc_clock::time_point tp) {
+    std::int64_t const nsecs = tp.time_since_epoch().count();
+    std::size_t i;
+    for (i = 0; i < table.size(); ++i) {
+        if (nsecs < table[i].when_utc) break;
+    }
+    double_leap const &l = table[i - 1];
+    double const leap_secs = l.offset + (to_mjd(tp).count() - l.mjd_ref) * l.drift;
+    return nsecs + static_cast<std::int64_t>(leap_secs * 1.0e9 + 0.5);
+}
+
+std::int64_t double_tai_to_utc(std::vector<double_leap> const &table, tai_clock::time_point tp) {
+    std::int64_t const nsecs = tp.time_since_epoch().count();
+    std::size_t i;
+    for (i = 0; i < table.size(); ++i) {
+        if (nsecs < table[i].when_tai) break;
+    }
+    double_leap const &l = table[i - 1];
+    double const leap_secs = (l.offset + (to_mjd(tp).count() - l.mjd_ref) * l.drift) / (1.0 + l.drift / 86400.0);
+    return nsecs - static_cast<std::int64_t>(leap_secs * 1.0e9 + 0.5);
+}
+
+// UTC <-> TAI in the pre-1972 entries of the leap second table, which have a drift term
+void bench_drift(std::size_t n) {
+    std::vector<utc_clock::time_point> utc(n);
+    auto const t0 = utc_clock::from_string("1961-01-01T00:00:00Z");
+    auto const t1 = utc_clock::from_string("1971-12-31T00:00:00Z");
+    auto const step = (t1 - t0) / static_cast<std::int64_t>(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        utc[i] = t0 + step * static_cast<std::int64_t>(i);
+    }
+    std::vector<tai_clock::time_point> tai(n);
+    auto const table = double_leap_table();
+
+    measure("double drift UTC->TAI (1961-1971)", n, [&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            tai[i] = tai_clock::time_point{std::chrono::nanoseconds{double_utc_to_tai(table, utc[i])}};
+        }
+    });
+    consume(tai);
+    measure("timescale_cast UTC->TAI (1961-1971)", n, [&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            tai[i] = timescale_cast<tai_clock>(utc[i]);
+        }
+    });
+    consume(tai);
+    std::vector<utc_clock::time_point> back(n);
+    measure("double drift TAI->UTC (1961-1971)", n, [&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            back[i] = utc_clock::time_point{std::chrono::nanoseconds{double_tai_to_utc(table, tai[i])}};
+        }
+    });
+    consume(back);
+    measure("timescale_cast TAI->UTC (1961-1971)", n, [&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            utc[i] = timescale_cast<utc_clock>(tai[i]);
+        }
+    });
+    consume(utc);
+}
+
+// to_string per time point against the batch formatter
+void bench_format(std::size_t n) {
+    std::vector<utc_clock::time_point> tps(n);
+    auto const t0 = utc_clock::from_string("2020-01-01T00:00:00Z");
+    for (std::size_t i = 0; i < n; ++i) {
+        tps[i] = t0 + std::chrono::nanoseconds{static_cast<std::int64_t>(i) * 1234567};
+    }
+
+    // to_string is slow, time it on part of the input
+    std::size_t const m = std::min<std::size_t>(n, 1000000);
+    std::vector<std::string> strings(m);
+    measure("to_string", m, [&] {
+        for (std::size_t i = 0; i < m; ++i) {
+            strings[i] = to_string(tps[i]);
+        }
+    });
+    consume(strings);
+    string_column column;
+    measure("format_column (1 thread)", n, [&] {
+        column.clear();
+        format_column(tps.data(), n, column, 1);
+    });
+    measure("format_column (all threads)", n, [&] {
+        column.clear();
+        format_column(tps.data(), n, column);
+    });
+    consume(column.data);
+}
+
+// Regex based from_string against the sniffing parser
+void bench_parse(std::size_t n) {
+    std::vector<utc_clock::time_point> tps(n);
+    auto const t0 = utc_clock::from_string("2020-01-01T00:00:00Z");
+    for (std::size_t i = 0; i < n; ++i) {
+        tps[i] = t0 + std::chrono::nanoseconds{static_cast<std::int64_t>(i) * 1234567};
+    }
+    string_column column = format_column(tps.data(), n);
+
+    // from_string compiles a regex per call, time it on a small part of the input
+    std::size_t const m = std::min<std::size_t>(n, 10000);
+    measure("from_string", m, [&] {
+        for (std::size_t i = 0; i < m; ++i) {
+            tps[i] = utc_clock::from_string(column[i]);
+        }
+    });
+    consume(tps);
+    measure("timestamp_parser", n, [&] {
+        timestamp_parser<utc_clock> parser;
+        for (std::size_t i = 0; i < n; ++i) {
+            parser.parse(column.begin(i), column.end(i), tps[i]);
+        }
+    });
+    consume(tps);
+    measure("timestamp_parser (locked)", n, [&] {
+        timestamp_parser<utc_clock> parser(1);
+        for (std::size_t i = 0; i < n; ++i) {
+            parser.parse(column.begin(i), column.end(i), tps[i]);
+        }
+    });
+    consume(tps);
+}
+
+// Converting whole streams to TAI and sorting against the streaming merge
+void bench_merge(std::size_t n) {
+    std::size_t const m = n / 4;
+    std::vector<utc_clock::time_point> utc(m);
+    std::vector<tai_clock::time_point> tai(m);
+    std::vector<tt_clock::time_point> tt(m);
+    std::vector<utc_clock::time_point> utc2(n - 3 * m);
+    auto const t0 = utc_clock::from_string("2015-06-30T00:00:00Z");
+    for (std::size_t i = 0; i < m; ++i) {
+        utc[i] = t0 + std::chrono::nanoseconds{static_cast<std::int64_t>(i) * 1234567};
+        tai[i] = timescale_cast<tai_clock>(t0) + std::chrono::nanoseconds{static_cast<std::int64_t>(i) * 1111111};
+        tt[i] = timescale_cast<tt_clock>(t0) + std::chrono::nanoseconds{static_cast<std::int64_t>(i) * 1333333};
+    }
+    for (std::size_t i = 0; i < utc2.size(); ++i) {
+        utc2[i] = t0 + std::chrono::nanoseconds{static_cast<std::int64_t>(i) * 999999};
+    }
+    std::vector<tai_clock::time_point> sorted(n);
+
+    measure("timescale_cast and sort (4 streams)", n, [&] {
+        timescale_cast<tai_clock>(utc.data(), m, sorted.data());
+        std::copy(tai.begin(), tai.end(), sorted.begin() + m);
+        timescale_cast<tai_clock>(tt.data(), m, sorted.data() + 2 * m);
+        timescale_cast<tai_clock>(utc2.data(), utc2.size(), sorted.data() + 3 * m);
+        std::sort(sorted.begin(), sorted.end());
+    });
+    consume(sorted);
+    measure("timescale_merge (4 streams)", n, [&] {
+        timescale_merge<tai_clock> merge;
+        merge.add_source(utc.begin(), utc.end());
+        merge.add_source(tai.begin(), tai.end());
+        merge.add_source(tt.begin(), tt.end());
+        merge.add_source(utc2.begin(), utc2.end());
+        timescale_merge<tai_clock>::value_type v;
+        for (std::size_t i = 0; merge.next(v); ++i) {
+            sorted[i] = v.time;
+        }
+    });
+    consume(sorted);
+}
+
+// Barycentric correction with the Earth position evaluated per photon and per cached block
+void bench_barycentric(std::size_t n) {
+    std::vector<tt_clock::time_point> tps(n);
+    auto const t0 = tt_clock::from_string("2020-01-01T00:00:00");
+    for (std::size_t i = 0; i < n; ++i) {
+        tps[i] = t0 + std::chrono::nanoseconds{static_cast<std::int64_t>(i) * 1234567};
+    }
+    std::vector<tdb_clock::time_point> out(n);
+    sky_direction const direction{1.4595, 0.3842};
+    observatory_position const observatory{1818939.0, -5208471.0, -3195172.0};
+
+    // evaluating the ephemeris per photon is slow, time it on part of the input
+    std::size_t const m = std::min<std::size_t>(n, 100000);
+    measure("barycentric_times (no cache)", m, [&] {
+        barycentric_times(tps.data(), m, direction, observatory, out.data(), std::chrono::nanoseconds{0});
+    });
+    consume(out);
+    measure("barycentric_times (cached)", n,
+            [&] { barycentric_times(tps.data(), n, direction, observatory, out.data()); });
+    consume(out);
+}
+
+// Masking sorted events by a set of good time intervals against a lookup per event
+void bench_interval(std::size_t n) {
+    std::vector<utc_clock::time_point> events(n);
+    auto const t0 = utc_clock::from_string("2016-12-31T00:00:00Z");
+    for (std::size_t i = 0; i < n; ++i) {
+        events[i] = t0 + std::chrono::nanoseconds{static_cast<std::int64_t>(i) * 1234567};
+    }
+    // 1000 intervals covering half of the events
+    std::vector<interval_set<tai_clock>::interval> intervals;
+    auto const span = (events.back() - events.front()) / 1000;
+    auto const first = timescale_cast<tai_clock>(t0);
+    for (int i = 0; i < 1000; ++i) {
+        intervals.push_back({first + i * span, first + i * span + span / 2});
+    }
+    interval_set<tai_clock> const gti(intervals.begin(), intervals.end());
+    std::vector<std::uint8_t> mask(n);
+
+    std::size_t const m = std::min<std::size_t>(n, 10000000);
+    measure("interval_set::contains", m, [&] {
+        for (std::size_t i = 0; i < m; ++i) {
+            mask[i] = gti.contains(events[i]);
+        }
+    });
+    consume(mask);
+    measure("interval_set::mask", n, [&] { gti.mask(events.data(), n, mask.data()); });
+    consume(mask);
+}
+
+// TAI to std::chrono::system_clock and back, through strings and timespec as done without
+// astrochrono_chrono.h against to_sys and from_sys
+void bench_chrono(std::size_t n) {
+    std::vector<tai_clock::time_point> tps(n);
+    auto const t0 = tai_clock::from_string("2020-01-01T00:00:00");
+    for (std::size_t i = 0; i < n; ++i) {
+        tps[i] = t0 + std::chrono::nanoseconds{static_cast<std::int64_t>(i) * 1234567};
+    }
+    std::vector<std::chrono::system_clock::time_point> sys(n);
+    std::vector<tai_clock::time_point> back(n);
+
+    // from_string is slow, time it on a small part of the input
+    std::size_t const m = std::min<std::size_t>(n, 10000);
+    measure("system_clock via to_string", m, [&] {
+        for (std::size_t i = 0; i < m; ++i) {
+            auto const utc = utc_clock::from_string(to_string(timescale_cast<utc_clock>(tps[i])));
+            struct timespec const ts = to_timespec(utc);
+            sys[i] = std::chrono::system_clock::time_point{
+                    std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                            std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec})};
+        }
+    });
+    consume(sys);
+    measure("system_clock via to_timespec", n, [&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            struct timespec const ts = to_timespec(timescale_cast<utc_clock>(tps[i]));
+            sys[i] = std::chrono::system_clock::time_point{
+                    std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                            std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec})};
+        }
+    });
+    consume(sys);
+    measure("to_sys array", n, [&] { to_sys(tps.data(), n, sys.data()); });
+    consume(sys);
+    measure("from_sys array", n, [&] { from_sys<tai_clock>(sys.data(), n, back.data()); });
+    consume(back);
+    std::vector<utc_clock::time_point> utc(n);
+    timescale_cast<utc_clock>(tps.data(), n, utc.data());
+    measure("to_sys array (utc, copy)", n, [&] { to_sys(utc.data(), n, sys.data()); });
+    consume(sys);
+}
+
+// Light curve binning through to_mjd and a floating point divide against time_bins
+void bench_binning(std::size_t n) {
+    std::vector<tt_clock::time_point> sorted(n);
+    auto const origin = tt_clock::from_mjd(59000.0);
+    for (std::size_t i = 0; i < n; ++i) {
+        sorted[i] = origin + std::chrono::nanoseconds{static_cast<std::int64_t>(i) * 1234567};
+    }
+    std::vector<tt_clock::time_point> shuffled(sorted);
+    std::reverse(shuffled.begin(), shuffled.end());
+    for (std::size_t i = 0; i + 7 < n; i += 8) {
+        std::swap(shuffled[i], shuffled[i + 7]);
+    }
+    // one minute bins over the whole input
+    std::size_t const bins = static_cast<std::size_t>((sorted.back() - origin) / std::chrono::minutes{1}) + 1;
+    time_bins<tt_clock> const grid(origin, std::chrono::minutes{1}, bins);
+    std::vector<time_bins<tt_clock>::index_type> index(n);
+
+    double const origin_mjd = 59000.0;
+    double const width_days = 1.0 / 1440;
+    measure("to_mjd and divide", n, [&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            index[i] = static_cast<time_bins<tt_clock>::index_type>(
+                    std::floor((to_mjd(shuffled[i]).count() - origin_mjd) / width_days));
+        }
+    });
+    consume(index);
+    measure("time_bins::assign (unsorted)", n, [&] { grid.assign(shuffled.data(), n, index.data()); });
+    consume(index);
+    measure("time_bins::assign (sorted)", n, [&] { grid.assign(sorted.data(), n, index.data()); });
+    consume(index);
+    std::vector<std::uint64_t> counts;
+    measure("time_bins::histogram (unsorted, 1 thread)", n,
+            [&] { counts = grid.histogram(shuffled.data(), n, 1); });
+    consume(counts);
+    measure("time_bins::histogram (unsorted)", n, [&] { counts = grid.histogram(shuffled.data(), n); });
+    consume(counts);
+    measure("time_bins::histogram (sorted)", n, [&] { counts = grid.histogram(sorted.data(), n); });
+    consume(counts);
+}
+
+// Recording trace events against reading tai_clock::now, and dumping a full ring
+void bench_trace(std::size_t n) {
+    trace_event const event = register_trace_event("bench");
+    std::size_t const m = std::min<std::size_t>(n, 1000000);
+    std::vector<tai_clock::time_point> now(m);
+    measure("tai_clock::now", m, [&] {
+        for (std::size_t i = 0; i < m; ++i) {
+            now[i] = tai_clock::now();
+        }
+    });
+    consume(now);
+    measure("trace", n, [&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            trace(event);
+        }
+    });
+    dump_trace();
+
+    std::size_t const capacity = std::size_t{1} << 20;
+    set_trace_buffer_size(capacity);
+    trace_dump dump;
+    measure("dump_trace", capacity, [&] {
+        std::thread([&] {
+            for (std::size_t i = 0; i < capacity; ++i) {
+                trace(event);
+            }
+        }).join();
+        dump = dump_trace();
+    });
+    consume(dump.records);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    std::size_t const n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000000;
+    if (n == 0) {
+        std::cerr << "usage: " << argv[0] << " [number of elements]" << std::endl;
+        return 1;
+    }
+    bench_mjd(n);
+    bench_drift(n);
+    bench_format(n);
+    bench_parse(n);
+    bench_merge(n);
+    bench_barycentric(n);
+    bench_interval(n);
+    bench_chrono(n);
+    bench_binning(n);
+    bench_trace(n);
+    return 0;
+}
@@ -0,0 +1,604 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+// astrochrono-convert: convert a column of timestamps between time scales and representations
+//
+//     astrochrono-convert [options] [file...]
+//
+// Reads the files (memory mapped) or standard input, converts the timestamps in one column of
+// every line and writes the lines to standard output, leaving the other columns untouched.
+// Lines are processed in chunks by a pool of threads with a bounded number of chunks in flight.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "astrochrono.h"
+#include "astrochrono_format.h"
+#include "astrochrono_parse.h"
+
+using namespace astrochrono;
+
+namespace {
+
+enum class scale { utc, tai, tt };
+
+enum class representation { iso, mjd, jd };
+
+struct options {
+    scale from = scale::utc;
+    scale to = scale::utc;
+    bool to_given = false;
+    representation output = representation::iso;
+    std::size_t column = 1;  // 1-based
+    char delimiter = ',';
+    std::size_t lock_after = 1000;
+    unsigned threads = 0;
+    std::size_t chunk_size = std::size_t{4} << 20;
+    bool quiet = false;
+    std::vector<std::string> files;
+};
+
+void usage(const char* name) {
+    std::cerr << "usage: " << name << " [options] [file...]\n"
+              << "Convert the timestamps in a column of each line of the files (or standard input).\n"
+              << "Input may be ISO 8601, FITS DATE-OBS, MJD, JD or Unix seconds.\n"
+              << "  -f, --from utc|tai|tt   time scale of input without a time scale of its own (utc)\n"
+              << "  -t, --to utc|tai|tt     time scale of the output (the input time scale)\n"
+              << "  -o, --output iso|mjd|jd representation of the output (iso)\n"
+              << "  -c, --column N          1-based column to convert (1)\n"
+              << "  -d, --delimiter C       column delimiter, \\t for a tab (,)\n"
+              << "  -l, --lock N            fix the input representation after N equal rows, 0 never (1000)\n"
+              << "  -j, --threads N         number of worker threads (number of hardware threads)\n"
+              << "  -b, --chunk-size BYTES  approximate size of the chunks of lines (4 MiB)\n"
+              << "  -q, --quiet             do not report the throughput\n";
+}
+
+scale parse_scale(std::string const& s) {
+    if (s == "utc") {
+        return scale::utc;
+    } else if (s == "tai") {
+        return scale::tai;
+    } else if (s == "tt") {
+        return scale::tt;
+    }
+    throw std::invalid_argument("Unknown time scale: " + s);
+}
+
+representation parse_representation(std::string const& s) {
+    if (s == "iso") {
+        return representation::iso;
+    } else if (s == "mjd") {
+        return representation::mjd;
+    } else if (s == "jd") {
+        return representation::jd;
+    }
+    throw std::invalid_argument("Unknown representation: " + s);
+}
+
+std::size_t parse_count(std::string const& s) {
+    char* end;
+    unsigned long long const n = std::strtoull(s.c_str(), &end, 10);
+    if (s.empty() || *end != '\0') {
+        throw std::invalid_argument("Not a number: " + s);
+    }
+    return static_cast<std::size_t>(n);
+}
+
+options parse_options(int argc, char** argv) {
+    options opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string const arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+        if (arg == "-f" || arg == "--from") {
+            opts.from = parse_scale(value());
+        } else if (arg == "-t" || arg == "--to") {
+            opts.to = parse_scale(value());
+            opts.to_given = true;
+        } else if (arg == "-o" || arg == "--output") {
+            opts.output = parse_representation(value());
+        } else if (arg == "-c" || arg == "--column") {
+            opts.column = parse_count(value());
+            if (opts.column == 0) {
+                throw std::invalid_argument("Columns are numbered from 1");
+            }
+        } else if (arg == "-d" || arg == "--delimiter") {
+            std::string const d = value();
+            if (d == "\\t") {
+                opts.delimiter = '\t';
+            } else if (d.size() == 1) {
+                opts.delimiter = d[0];
+            } else {
+                throw std::invalid_argument("Delimiter must be a single character: " + d);
+            }
+        } else if (arg == "-l" || arg == "--lock") {
+            opts.lock_after = parse_count(value());
+        } else if (arg == "-j" || arg == "--threads") {
+            opts.threads = static_cast<unsigned>(parse_count(value()));
+        } else if (arg == "-b" || arg == "--chunk-size") {
+            opts.chunk_size = std::max<std::size_t>(1, parse_count(value()));
+        } else if (arg == "-q" || arg == "--quiet") {
+            opts.quiet = true;
+        } else if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            std::exit(0);
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            throw std::invalid_argument("Unknown option: " + arg);
+        } else {
+            opts.files.push_back(arg);
+        }
+    }
+    if (!opts.to_given) {
+        opts.to = opts.from;
+    }
+    if (opts.threads == 0) {
+        opts.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return opts;
+}
+
+// Output writers per representation
+template <representation R>
+struct writer;
+
+template <>
+struct writer<representation::iso> {
+    static constexpr std::size_t max_size = time_format<patterns::iso8601>::max_size;
+
+    template <typename TimePoint>
+    static char* put(char* out, TimePoint const& tp) noexcept {
+        return time_format<patterns::iso8601>::format_to(out, tp);
+    }
+};
+
+// 15 decimals, enough for the MJD or JD to parse back to the same nanosecond
+static constexpr int DAY_DECIMALS = 15;
+
+template <>
+struct writer<representation::mjd> {
+    static constexpr std::size_t max_size = 9 + DAY_DECIMALS;
+
+    template <typename TimePoint>
+    static char* put(char* out, TimePoint const& tp) noexcept {
+        auto const t = detail::break_down(tp.time_since_epoch().count());
+        return detail::put_day_number<DAY_DECIMALS>(out, t.days + detail::EPOCH_MJD, t.nsec_of_day);
+    }
+};
+
+template <>
+struct writer<representation::jd> {
+    static constexpr std::size_t max_size = 9 + DAY_DECIMALS;
+
+    template <typename TimePoint>
+    static char* put(char* out, TimePoint const& tp) noexcept {
+        // JD days start at noon
+        auto const t = detail::break_down(tp.time_since_epoch().count());
+        std::int64_t day = t.days + detail::EPOCH_MJD + 2400000;
+        std::int64_t nsec_of_day = t.nsec_of_day + detail::NSEC_PER_DAY / 2;
+        if (nsec_of_day >= detail::NSEC_PER_DAY) {
+            ++day;
+            nsec_of_day -= detail::NSEC_PER_DAY;
+        }
+        return detail::put_day_number<DAY_DECIMALS>(out, day, nsec_of_day);
+    }
+};
+
+// Counters of a converted chunk
+struct chunk_stats {
+    std::size_t lines = 0;
+    std::size_t failed = 0;
+};
+
+// Convert the lines of [first, last) into out. Lines whose column is not a valid timestamp are
+// passed through unchanged.
+using convert_function = chunk_stats (*)(options const&, const char*, const char*, std::string&);
+
+template <typename FromClock, typename ToClock, representation R>
+chunk_stats convert_chunk(options const& opts, const char* first, const char* last, std::string& out) {
+    chunk_stats stats;
+    timestamp_parser<FromClock> parser(opts.lock_after);
+    out.clear();
+    out.reserve(static_cast<std::size_t>(last - first) + (last - first) / 2);
+    char buf[writer<R>::max_size];
+    while (first != last) {
+        const char* const eol = static_cast<const char*>(std::memchr(first, '\n', last - first));
+        const char* const end = eol ? eol : last;
+        ++stats.lines;
+        // find the column
+        const char* field = first;
+        for (std::size_t c = 1; c < opts.column && field != end; ++c) {
+            const char* const next = static_cast<const char*>(std::memchr(field, opts.delimiter, end - field));
+            field = next ? next + 1 : end;
+        }
+        const char* field_end = static_cast<const char*>(std::memchr(field, opts.delimiter, end - field));
+        field_end = field_end ? field_end : end;
+        // tolerate CRLF line ends
+        if (field_end == end && field_end != field && field_end[-1] == '\r') {
+            --field_end;
+        }
+        typename FromClock::time_point tp;
+        bool converted = false;
+        if (field != end && parser.parse(field, field_end, tp)) {
+            try {
+                char* const e = writer<R>::put(buf, timescale_cast<ToClock>(tp));
+                out.append(first, field);
+                out.append(buf, e);
+                out.append(field_end, end);
+                converted = true;
+            } catch (std::domain_error const&) {
+            }
+        }
+        if (!converted) {
+            ++stats.failed;
+            out.append(first, end);
+        }
+        if (eol) {
+            out.push_back('\n');
+            first = eol + 1;
+        } else {
+            first = last;
+        }
+    }
+    return stats;
+}
+
+template <typename FromClock, typename ToClock>
+convert_function select(representation output) {
+    switch (output) {
+        case representation::iso:
+            return convert_chunk<FromClock, ToClock, representation::iso>;
+        case representation::mjd:
+            return convert_chunk<FromClock, ToClock, representation::mjd>;
+        default:
+            return convert_chunk<FromClock, ToClock, representation::jd>;
+    }
+}
+
+template <typename FromClock>
+convert_function select(scale to, representation output) {
+    switch (to) {
+        case scale::utc:
+            return select<FromClock, utc_clock>(output);
+        case scale::tai:
+            return select<FromClock, tai_clock>(output);
+        default:
+            return select<FromClock, tt_clock>(output);
+    }
+}
+
+convert_function select(scale from, scale to, representation output) {
+    switch (from) {
+        case scale::utc:
+            return select<utc_clock>(to, output);
+        case scale::tai:
+            return select<tai_clock>(to, output);
+        default:
+            return select<tt_clock>(to, output);
+    }
+}
+
+// A chunk of whole lines, either a view into a mapped file or owned
+struct chunk {
+    const char* first = nullptr;
+    const char* last = nullptr;
+    std::string owned;
+    std::string output;
+    chunk_stats stats;
+    bool done = false;
+};
+
+/* Pipeline of a reader (the calling thread), worker threads and an ordered writer thread.
+ *
+ * Chunks cycle through a fixed ring of slots, so at most slots chunks of input and output are held
+ * in memory. The reader waits for the writer to release a slot before refilling it.
+ */
+class pipeline {
+public:
+    pipeline(options const& opts, convert_function convert)
+            : opts_(opts), convert_(convert), slots_(2 * opts.threads + 2) {
+        for (unsigned i = 0; i < opts.threads; ++i) {
+            workers_.emplace_back([this] { work(); });
+        }
+        writer_ = std::thread([this] { write(); });
+    }
+
+    ~pipeline() { finish(); }
+
+    // Next free chunk, blocks while all slots are in use
+    chunk& acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        released_.wait(lock, [this] { return read_ - written_ < slots_.size(); });
+        chunk& c = slots_[read_ % slots_.size()];
+        c.done = false;
+        c.owned.clear();
+        return c;
+    }
+
+    // Queue the chunk returned by the last acquire for conversion
+    void submit() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(read_++);
+        queued_.notify_one();
+    }
+
+    // Wait until everything is written and stop the threads
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                return;
+            }
+            stopping_ = true;
+        }
+        queued_.notify_all();
+        converted_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+        writer_.join();
+    }
+
+    chunk_stats stats() const { return stats_; }
+
+    bool write_failed() const { return write_failed_; }
+
+private:
+    void work() {
+        for (;;) {
+            std::size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                queued_.wait(lock, [this] { return !queue_.empty() || stopping_; });
+                if (queue_.empty()) {
+                    return;
+                }
+                index = queue_.front();
+                queue_.pop_front();
+            }
+            chunk& c = slots_[index % slots_.size()];
+            c.stats = convert_(opts_, c.first, c.last, c.output);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                c.done = true;
+            }
+            converted_.notify_all();
+        }
+    }
+
+    void write() {
+        for (;;) {
+            chunk* c;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                converted_.wait(lock, [this] {
+                    return (written_ < read_ && slots_[written_ % slots_.size()].done) ||
+                           (stopping_ && written_ == read_);
+                });
+                if (written_ == read_) {
+                    return;
+                }
+                c = &slots_[written_ % slots_.size()];
+            }
+            if (!write_failed_ && std::fwrite(c->output.data(), 1, c->output.size(), stdout) != c->output.size()) {
+                write_failed_ = true;
+            }
+            stats_.lines += c->stats.lines;
+            stats_.failed += c->stats.failed;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++written_;
+            }
+            released_.notify_one();
+        }
+    }
+
+    options const& opts_;
+    convert_function convert_;
+    std::vector<chunk> slots_;
+    std::deque<std::size_t> queue_;
+    std::size_t read_ = 0;     // number of chunks submitted
+    std::size_t written_ = 0;  // number of chunks written
+    bool stopping_ = false;
+    std::atomic<bool> write_failed_{false};
+    chunk_stats stats_;
+    std::mutex mutex_;
+    std::condition_variable queued_;
+    std::condition_variable converted_;
+    std::condition_variable released_;
+    std::vector<std::thread> workers_;
+    std::thread writer_;
+};
+
+// End of the last whole line in [first, last), or nullptr if there is no line end at all
+const char* last_line_end(const char* first, const char* last) {
+    for (const char* p = last; p != first; --p) {
+        if (p[-1] == '\n') {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+// Split a memory mapped file into chunks of whole lines
+std::size_t process_mapped(pipeline& pipe, options const& opts, const char* data, std::size_t size) {
+    const char* p = data;
+    const char* const end = data + size;
+    while (p != end) {
+        const char* last = p + std::min(opts.chunk_size, static_cast<std::size_t>(end - p));
+        if (last != end) {
+            // extend to the end of the line, or cut at the last complete line
+            const char* const eol = static_cast<const char*>(std::memchr(last, '\n', end - last));
+            last = eol ? eol + 1 : end;
+        }
+        chunk& c = pipe.acquire();
+        c.first = p;
+        c.last = last;
+        pipe.submit();
+        p = last;
+    }
+    return size;
+}
+
+// Read a stream into owned chunks of whole lines, throws on a read error
+std::size_t process_stream(pipeline& pipe, options const& opts, std::FILE* in, std::string const& name) {
+    std::size_t total = 0;
+    std::string carry;
+    std::vector<char> buf(opts.chunk_size);
+    for (;;) {
+        std::size_t const n = std::fread(buf.data(), 1, buf.size(), in);
+        total += n;
+        bool const eof = n < buf.size();
+        if (eof && std::ferror(in)) {
+            throw std::runtime_error("Cannot read " + name + ": " + std::strerror(errno));
+        }
+        const char* const data = buf.data();
+        const char* const cut = eof ? data + n : last_line_end(data, data + n);
+        if (!cut) {
+            // a line longer than the buffer, keep reading until it ends
+            carry.append(data, n);
+            continue;
+        }
+        chunk& c = pipe.acquire();
+        c.owned.swap(carry);
+        c.owned.append(data, cut);
+        carry.assign(cut, data + n);
+        if (c.owned.empty() && eof) {
+            // nothing left, hand in an empty chunk
+            c.first = c.last = nullptr;
+            pipe.submit();
+            break;
+        }
+        c.first = c.owned.data();
+        c.last = c.owned.data() + c.owned.size();
+        pipe.submit();
+        if (eof) {
+            break;
+        }
+    }
+    return total;
+}
+
+std::size_t process_file(pipeline& pipe, options const& opts, std::string const& name) {
+    if (name == "-") {
+        return process_stream(pipe, opts, stdin, "standard input");
+    }
+    int const fd = ::open(name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + name + ": " + std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        // not mappable, read it as a stream
+        std::FILE* const in = ::fdopen(fd, "rb");
+        std::size_t n;
+        try {
+            n = process_stream(pipe, opts, in, name);
+        } catch (...) {
+            std::fclose(in);
+            throw;
+        }
+        std::fclose(in);
+        return n;
+    }
+    auto const size = static_cast<std::size_t>(st.st_size);
+    void* const data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Cannot map " + name + ": " + std::strerror(errno));
+    }
+    ::madvise(data, size, MADV_SEQUENTIAL);
+    process_mapped(pipe, opts, static_cast<const char*>(data), size);
+    // the chunks refer to the mapping until they are written
+    pipe.finish();
+    ::munmap(data, size);
+    return size;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    options opts;
+    try {
+        opts = parse_options(argc, argv);
+    } catch (std::exception const& e) {
+        std::cerr << argv[0] << ": " << e.what() << "\n";
+        usage(argv[0]);
+        return 2;
+    }
+    if (opts.files.empty()) {
+        opts.files.push_back("-");
+    }
+    convert_function const convert = select(opts.from, opts.to, opts.output);
+
+    auto const start = std::chrono::steady_clock::now();
+    std::size_t bytes = 0;
+    chunk_stats stats;
+    bool write_failed = false;
+    try {
+        for (auto const& file : opts.files) {
+            // one pipeline per file, a mapped file must stay mapped until its last chunk is written
+            pipeline pipe(opts, convert);
+            bytes += process_file(pipe, opts, file);
+            pipe.finish();
+            stats.lines += pipe.stats().lines;
+            stats.failed += pipe.stats().failed;
+            write_failed = write_failed || pipe.write_failed();
+        }
+    } catch (std::exception const& e) {
+        std::cerr << argv[0] << ": " << e.what() << "\n";
+        return 1;
+    }
+    if (std::fflush(stdout) != 0 || write_failed) {
+        std::cerr << argv[0] << ": write error\n";
+        return 1;
+    }
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+    if (!opts.quiet) {
+        std::fprintf(stderr, "%zu lines, %zu not converted, %.1f MB in %.3f s: %.2f M lines/s, %.1f MB/s\n",
+                     stats.lines, stats.failed, bytes / 1e6, elapsed.count(), stats.lines / elapsed.count() / 1e6,
+                     bytes / elapsed.count() / 1e6);
+    }
+    return 0;
+}
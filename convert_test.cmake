@@ -0,0 +1,32 @@
+# Run astrochrono-convert on a fixture from standard input and as a mapped file, with chunks
+# shorter than some of its lines, and compare the output and line counts with the expected ones.
+# A directory, which opens but cannot be read, must fail with a read error.
+#
+#     cmake -DCONVERT=<astrochrono-convert> -DINPUT=<csv> -DEXPECTED=<csv> -P convert_test.cmake
+
+file(READ ${EXPECTED} expected)
+foreach (mode stdin file)
+    if (mode STREQUAL "stdin")
+        execute_process(COMMAND ${CONVERT} -j 2 -b 16 -f tai -o jd -c 2
+            INPUT_FILE ${INPUT} OUTPUT_VARIABLE output ERROR_VARIABLE report RESULT_VARIABLE result)
+    else (mode STREQUAL "stdin")
+        execute_process(COMMAND ${CONVERT} -j 2 -b 16 -f tai -o jd -c 2 ${INPUT}
+            OUTPUT_VARIABLE output ERROR_VARIABLE report RESULT_VARIABLE result)
+    endif (mode STREQUAL "stdin")
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "${mode}: exit status ${result}: ${report}")
+    endif (NOT result EQUAL 0)
+    if (NOT output STREQUAL expected)
+        message(FATAL_ERROR "${mode}: unexpected output\n${output}")
+    endif (NOT output STREQUAL expected)
+    if (NOT report MATCHES "^6 lines, 1 not converted")
+        message(FATAL_ERROR "${mode}: unexpected counts: ${report}")
+    endif (NOT report MATCHES "^6 lines, 1 not converted")
+endforeach (mode)
+
+get_filename_component(directory ${INPUT} DIRECTORY)
+execute_process(COMMAND ${CONVERT} -f tai -o jd ${directory}
+    OUTPUT_VARIABLE output ERROR_VARIABLE report RESULT_VARIABLE result)
+if (result EQUAL 0 OR NOT report MATCHES "Cannot read")
+    message(FATAL_ERROR "directory: exit status ${result}: ${report}")
+endif (result EQUAL 0 OR NOT report MATCHES "Cannot read")
@@ -20,11 +20,28 @@
  * see <https://www.lsstcorp.org/LegalNotices/>.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <chrono>
+#include <map>
+#include <vector>
+#include <sstream>
+#include <thread>
 #include <unistd.h>
 
 #include "astrochrono.h"
+#include "astrochrono_format.h"
+#include "astrochrono_compact.h"
+#include "astrochrono_index.h"
+#include "astrochrono_column.h"
+#include "astrochrono_parse.h"
+#include "astrochrono_literals.h"
+#include "astrochrono_merge.h"
+#include "astrochrono_barycentric.h"
+#include "astrochrono_trace.h"
+#include "astrochrono_interval.h"
+#include "astrochrono_chrono.h"
+#include "astrochrono_binning.h"
 
 #define BOOST_TEST_MODULE BasicTest
 #include <boost/test/unit_test.hpp>
@@ -34,6 +51,11 @@ using namespace astrochrono;
 namespace sc = std::chrono;
 namespace tt = boost::test_tools;
 
+template <typename TimePoint>
+std::int64_t nsecs(TimePoint const& tp) {
+    return tp.time_since_epoch().count();
+}
+
 BOOST_AUTO_TEST_SUITE(AstrochronoTestSuite)
 
 BOOST_AUTO_TEST_CASE(Gmtime) {
@@ -448,4 +470,1008 @@ BOOST_AUTO_TEST_CASE(InvalidDate) {
     }
 }
 
+struct mjd6_pattern {
+    static constexpr const char* pattern() { return "%6Q"; }
+};
+
+struct jd3_pattern {
+    static constexpr const char* pattern() { return "JD %3J"; }
+};
+
+BOOST_AUTO_TEST_CASE(FormatMatchesToString) {
+    for (auto ns : {-1000000001LL, -1LL, 0LL, 1LL, 1238657199314159265LL, -26392807668252446LL}) {
+        auto utc = utc_clock::time_point{sc::nanoseconds{ns}};
+        auto tai = tai_clock::time_point{sc::nanoseconds{ns}};
+        auto tt = tt_clock::time_point{sc::nanoseconds{ns}};
+        BOOST_TEST(time_format<patterns::iso8601>::format(utc) == to_string(utc));
+        BOOST_TEST(time_format<patterns::iso8601>::format(tai) == to_string(tai));
+        BOOST_TEST(time_format<patterns::iso8601>::format(tt) == to_string(tt));
+        BOOST_TEST(nsecs(time_format<patterns::iso8601>::parse<utc_clock>(to_string(utc))) == nsecs(utc));
+        BOOST_TEST(nsecs(time_format<patterns::iso8601>::parse<tai_clock>(to_string(tai))) == nsecs(tai));
+        BOOST_TEST(nsecs(time_format<patterns::iso8601>::parse<tt_clock>(to_string(tt))) == nsecs(tt));
+    }
+    BOOST_TEST(time_format<patterns::iso8601>::is_fixed_width);
+    BOOST_TEST(time_format<patterns::iso8601>::max_size == 30u);
+}
+
+BOOST_AUTO_TEST_CASE(FormatPatterns) {
+    auto tp = utc_clock::from_string("2009-04-02T07:26:39.314159265Z");
+    BOOST_TEST(time_format<patterns::iso8601_basic>::format(tp) == "20090402T072639.314159265Z");
+    BOOST_TEST(time_format<patterns::fits_date_obs>::format(tp) == "2009-04-02T07:26:39.314");
+    BOOST_TEST(time_format<patterns::day_of_year>::format(tp) == "2009-092T07:26:39");
+    BOOST_TEST(time_format<mjd6_pattern>::format(tp) == "54923.310177");
+    BOOST_TEST(time_format<jd3_pattern>::format(tp) == "JD 2454923.810");
+    BOOST_TEST(!time_format<mjd6_pattern>::is_fixed_width);
+
+    auto tai = timescale_cast<tai_clock>(tp);
+    BOOST_TEST(time_format<patterns::iso8601_basic>::format(tai) == "20090402T072713.314159265");
+
+    // before MJD 0
+    auto early = tt_clock::time_point{sc::nanoseconds{-3506738400000000000LL}};
+    BOOST_TEST(time_format<patterns::iso8601>::format(early) == "1858-11-16T18:00:00.000000000");
+    BOOST_TEST(time_format<mjd6_pattern>::format(early) == "-0.250000");
+    BOOST_TEST(nsecs(time_format<mjd6_pattern>::parse<tt_clock>("-0.250000")) == nsecs(early));
+}
+
+BOOST_AUTO_TEST_CASE(FormatParse) {
+    auto tp = tai_clock::from_string("2009-04-02T07:26:39.314");
+    BOOST_TEST(nsecs(time_format<patterns::fits_date_obs>::parse<tai_clock>("2009-04-02T07:26:39.314")) ==
+               nsecs(tp));
+    BOOST_TEST(nsecs(time_format<patterns::day_of_year>::parse<tai_clock>("2009-092T07:26:39")) ==
+               nsecs(tai_clock::from_string("2009-04-02T07:26:39")));
+    BOOST_TEST(nsecs(time_format<patterns::iso8601_basic>::parse<utc_clock>("20090402T072639.314159265Z")) ==
+               nsecs(utc_clock::from_string("2009-04-02T07:26:39.314159265Z")));
+    BOOST_TEST(nsecs(time_format<mjd6_pattern>::parse<tai_clock>("54923.310177")) == 1238657199292800000LL);
+    BOOST_TEST(nsecs(time_format<jd3_pattern>::parse<tai_clock>("JD 2440588.000")) ==
+               nsecs(tai_clock::from_string("1970-01-01T12:00:00")));
+
+    // UTC requires "Z", TAI and TT forbid it
+    BOOST_CHECK_THROW(time_format<patterns::iso8601>::parse<utc_clock>("2009-04-02T07:26:39.314159265"),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(time_format<patterns::iso8601>::parse<tt_clock>("2009-04-02T07:26:39.314159265Z"),
+                      std::invalid_argument);
+    // fixed width fields
+    BOOST_CHECK_THROW(time_format<patterns::fits_date_obs>::parse<tai_clock>("2009-04-02T07:26:39.31"),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(time_format<patterns::fits_date_obs>::parse<tai_clock>("2009-04-02T07:26:39.3141"),
+                      std::invalid_argument);
+    // invalid dates
+    BOOST_CHECK_THROW(time_format<patterns::fits_date_obs>::parse<tai_clock>("2009-02-29T07:26:39.314"),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(time_format<patterns::day_of_year>::parse<tai_clock>("2009-366T07:26:39"),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(time_format<patterns::day_of_year>::parse<tai_clock>("2009-000T07:26:39"),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(time_format<patterns::fits_date_obs>::parse<tai_clock>("2009-04-02T24:26:39.314"),
+                      std::invalid_argument);
+    // out of range of 64-bit nanoseconds
+    BOOST_CHECK_THROW(time_format<patterns::fits_date_obs>::parse<tai_clock>("2263-04-02T07:26:39.314"),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(TimescaleSegment) {
+    // 2015 JUL 1 leap second
+    auto segment = find_timescale_segment<tai_clock>(utc_clock::from_mjd(57000.));
+    BOOST_TEST(segment.is_constant);
+    BOOST_TEST(segment.offset.count() == 35000000000LL);
+    BOOST_TEST(nsecs(segment.first) == nsecs(utc_clock::from_string("2012-07-01T00:00:00Z")));
+    BOOST_TEST(nsecs(segment.last) == nsecs(utc_clock::from_string("2015-07-01T00:00:00Z")) - 1);
+
+    auto tt_point = timescale_cast<tt_clock>(utc_clock::from_mjd(57000.));
+    auto tt_segment = find_timescale_segment<utc_clock>(tt_point);
+    BOOST_TEST(tt_segment.offset.count() == -35000000000LL - 32184000000LL);
+    BOOST_TEST(nsecs(tt_segment.first) == nsecs(timescale_cast<tt_clock>(segment.first)));
+
+    BOOST_TEST(!find_timescale_segment<tai_clock>(utc_clock::from_mjd(39000.)).is_constant);
+    BOOST_TEST(find_timescale_segment<tt_clock>(tai_clock::from_mjd(39000.)).is_constant);
+    BOOST_CHECK_THROW(find_timescale_segment<tai_clock>(utc_clock::from_mjd(37000.)), std::domain_error);
+}
+
+BOOST_AUTO_TEST_CASE(TimescaleCastArray) {
+    // unsorted, across leap seconds and pre-1972 entries
+    std::vector<utc_clock::time_point> utc;
+    for (int i = 0; i < 5000; ++i) {
+        utc.push_back(utc_clock::from_mjd(57204.0 + (i % 7 - 3) * 1.0e-5 + i * 1.0e-7));
+        utc.push_back(utc_clock::from_mjd(38000.0 + i * 0.37));
+    }
+    std::vector<tt_clock::time_point> tt(utc.size());
+    timescale_cast<tt_clock>(utc.data(), utc.size(), tt.data());
+    std::vector<utc_clock::time_point> back(utc.size());
+    timescale_cast<utc_clock>(tt.data(), tt.size(), back.data());
+    for (std::size_t i = 0; i < utc.size(); ++i) {
+        BOOST_TEST(nsecs(tt[i]) == nsecs(timescale_cast<tt_clock>(utc[i])));
+        BOOST_TEST(nsecs(back[i]) == nsecs(timescale_cast<utc_clock>(tt[i])));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(CompactColumn) {
+    std::vector<tai_clock::time_point> tps;
+    auto t0 = tai_clock::from_string("2015-06-30T23:00:00");
+    for (int i = 0; i < 200000; ++i) {
+        // spans more than 2^32 microseconds
+        tps.push_back(t0 + sc::microseconds{static_cast<std::int64_t>(i) * 123457});
+    }
+    compact_time_column<tai_clock> column(tps.data(), tps.size());
+    BOOST_TEST(column.size() == tps.size());
+    BOOST_TEST(column.blocks().size() > 1u);
+    std::vector<tai_clock::time_point> widened(column.size());
+    column.widen(widened.data());
+    for (std::size_t i = 0; i < tps.size(); i += 97) {
+        BOOST_TEST(nsecs(widened[i]) == nsecs(tps[i]));
+        BOOST_TEST(nsecs(column[i]) == nsecs(tps[i]));
+    }
+
+    // truncation to the resolution
+    auto odd = t0 + sc::nanoseconds{1999};
+    compact_time_column<tai_clock> truncated(&odd, 1);
+    BOOST_TEST(nsecs(truncated[0]) == nsecs(t0 + sc::microseconds{1}));
+
+    // blocks inside and across the 2015 JUL 1 leap second
+    auto utc = timescale_cast<utc_clock>(column);
+    BOOST_TEST(utc.size() == column.size());
+    std::vector<utc_clock::time_point> utc_widened(utc.size());
+    utc.widen(utc_widened.data());
+    for (std::size_t i = 0; i < tps.size(); i += 97) {
+        BOOST_TEST(nsecs(utc_widened[i]) == nsecs(timescale_cast<utc_clock>(tps[i])));
+    }
+    auto tt = timescale_cast<tt_clock>(column);
+    BOOST_TEST(tt.blocks().size() == column.blocks().size());
+    BOOST_TEST(nsecs(tt[12345]) == nsecs(timescale_cast<tt_clock>(tps[12345])));
+}
+
+BOOST_AUTO_TEST_CASE(CompactColumnShiftedBase) {
+    // TT - TAI = 32.184 s is not a whole number of seconds, so shifting the block bases
+    // must give the same column as widening, converting and narrowing again
+    std::vector<tai_clock::time_point> tps;
+    auto t0 = tai_clock::from_string("2015-06-30T23:00:00");
+    for (int i = 0; i < 1000; ++i) {
+        tps.push_back(t0 + sc::milliseconds{static_cast<std::int64_t>(i) * 2345});
+    }
+    compact_time_column<tai_clock, sc::seconds> column(tps.data(), tps.size());
+    std::vector<tai_clock::time_point> widened(column.size());
+    column.widen(widened.data());
+    std::vector<tt_clock::time_point> converted(column.size());
+    timescale_cast<tt_clock>(widened.data(), widened.size(), converted.data());
+    compact_time_column<tt_clock, sc::seconds> slow(converted.data(), converted.size());
+
+    auto tt = timescale_cast<tt_clock>(column);
+    BOOST_TEST(tt.size() == slow.size());
+    for (std::size_t i = 0; i < tt.size(); ++i) {
+        BOOST_TEST(nsecs(tt[i]) == nsecs(slow[i]));
+    }
+    BOOST_TEST(nsecs(tt[0]) % 1000000000 == 0);
+
+    // a whole second offset keeps the fast path and the same blocks
+    auto utc = timescale_cast<utc_clock>(column);
+    BOOST_TEST(utc.blocks().size() == column.blocks().size());
+    BOOST_TEST(nsecs(utc[10]) == nsecs(timescale_cast<utc_clock>(widened[10])));
+}
+
+BOOST_AUTO_TEST_CASE(TimeIndex) {
+    for (std::size_t n : {0, 1, 16, 17, 300, 5000, 70000}) {
+        std::vector<utc_clock::time_point> tps;
+        auto t0 = utc_clock::from_string("2015-06-30T00:00:00Z");
+        for (std::size_t i = 0; i < n; ++i) {
+            // duplicates and gaps
+            tps.push_back(t0 + sc::seconds{static_cast<std::int64_t>(i / 3 * 7)});
+        }
+        time_index<utc_clock> index(tps.data(), tps.size());
+        std::vector<utc_clock::time_point> queries;
+        for (std::int64_t s = -10; s < static_cast<std::int64_t>(n) * 3 + 10; s += 5) {
+            queries.push_back(t0 + sc::milliseconds{s * 777});
+        }
+        std::vector<std::size_t> batched(queries.size());
+        index.lower_bound(queries.data(), queries.size(), batched.data());
+        std::vector<std::size_t> nearest(queries.size());
+        index.nearest(queries.data(), queries.size(), nearest.data());
+        for (std::size_t q = 0; q < queries.size(); ++q) {
+            auto expected =
+                    static_cast<std::size_t>(std::lower_bound(tps.begin(), tps.end(), queries[q]) - tps.begin());
+            BOOST_TEST(index.lower_bound(queries[q]) == expected);
+            BOOST_TEST(batched[q] == expected);
+            auto upper = std::upper_bound(tps.begin(), tps.end(), queries[q]);
+            BOOST_TEST(index.upper_bound(queries[q]) == static_cast<std::size_t>(upper - tps.begin()));
+            BOOST_TEST(index.nearest(queries[q]) == nearest[q]);
+            if (n > 0) {
+                auto distance = [&](std::size_t i) { return std::abs(nsecs(tps[i]) - nsecs(queries[q])); };
+                BOOST_TEST(distance(nearest[q]) <= distance(expected < n ? expected : n - 1));
+                BOOST_TEST(distance(nearest[q]) <= distance(expected > 0 ? expected - 1 : 0));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TimeIndexOtherClock) {
+    std::vector<utc_clock::time_point> tps;
+    for (int i = 0; i < 10000; ++i) {
+        tps.push_back(utc_clock::from_mjd(57203.9 + i * 2.0e-5));
+    }
+    time_index<utc_clock> index(tps.data(), tps.size());
+    // TAI MJD bounds on a UTC index
+    auto r = index.range_mjd<tai_clock>(57204.0, 57204.05);
+    auto first =
+            std::lower_bound(tps.begin(), tps.end(), timescale_cast<utc_clock>(tai_clock::from_mjd(57204.0)));
+    auto last =
+            std::lower_bound(tps.begin(), tps.end(), timescale_cast<utc_clock>(tai_clock::from_mjd(57204.05)));
+    BOOST_TEST(r.first == static_cast<std::size_t>(first - tps.begin()));
+    BOOST_TEST(r.second == static_cast<std::size_t>(last - tps.begin()));
+
+    std::vector<tt_clock::time_point> from{tt_clock::from_mjd(57203.95), tt_clock::from_mjd(57204.1)};
+    std::vector<tt_clock::time_point> to{tt_clock::from_mjd(57204.0), tt_clock::from_mjd(57205.0)};
+    std::vector<std::pair<std::size_t, std::size_t>> ranges(2);
+    index.range(from.data(), to.data(), 2, ranges.data());
+    BOOST_TEST(ranges[0].first == index.lower_bound(from[0]));
+    BOOST_TEST(ranges[0].second == index.lower_bound(to[0]));
+    BOOST_TEST(ranges[1].second == tps.size());
+}
+
+BOOST_AUTO_TEST_CASE(ArrayMjdJd) {
+    std::vector<tai_clock::time_point> tps;
+    for (std::int64_t ns : {std::int64_t{0}, std::int64_t{-1}, std::int64_t{1}, std::int64_t{43200000000000},
+                            std::int64_t{-3506738400000000000}, std::int64_t{1435708800123456789},
+                            std::numeric_limits<std::int64_t>::min() + 1, std::numeric_limits<std::int64_t>::max()}) {
+        tps.push_back(tai_clock::time_point{sc::nanoseconds{ns}});
+    }
+    std::size_t const n = tps.size();
+
+    // split representation round trips exactly
+    std::vector<split_days> mjd_split(n);
+    std::vector<split_days> jd_split(n);
+    to_mjd(tps.data(), n, mjd_split.data());
+    to_jd(tps.data(), n, jd_split.data());
+    BOOST_TEST(mjd_split[0].day == 40587);
+    BOOST_TEST(mjd_split[0].fraction == 0.0);
+    BOOST_TEST(mjd_split[1].day == 40586);
+    BOOST_TEST(jd_split[0].day == 2440587);
+    BOOST_TEST(jd_split[0].fraction == 0.5);
+    BOOST_TEST(jd_split[3].day == 2440588);
+    BOOST_TEST(jd_split[3].fraction == 0.0);
+    std::vector<tai_clock::time_point> back(n);
+    std::vector<std::uint8_t> mask(n);
+    BOOST_TEST(from_mjd<tai_clock>(mjd_split.data(), n, back.data(), mask.data()) == 0u);
+    for (std::size_t i = 0; i < n; ++i) {
+        BOOST_TEST(nsecs(back[i]) == nsecs(tps[i]));
+        BOOST_TEST(mask[i] == 0);
+    }
+    BOOST_TEST(from_jd<tai_clock>(jd_split.data(), n, back.data(), mask.data()) == 0u);
+    for (std::size_t i = 0; i < n; ++i) {
+        BOOST_TEST(nsecs(back[i]) == nsecs(tps[i]));
+    }
+
+    // doubles agree with the scalar conversions
+    std::vector<double> mjd(n);
+    std::vector<double> jd(n);
+    to_mjd(tps.data(), n, mjd.data());
+    to_jd(tps.data(), n, jd.data());
+    for (std::size_t i = 0; i < n; ++i) {
+        BOOST_TEST(mjd[i] == to_mjd(tps[i]).count(), boost::test_tools::tolerance(1e-15));
+        BOOST_TEST(jd[i] == to_jd(tps[i]).count(), boost::test_tools::tolerance(1e-15));
+    }
+    // and round trip to within the resolution of a double
+    BOOST_TEST(from_mjd<tai_clock>(mjd.data(), 6, back.data(), mask.data()) == 0u);
+    for (std::size_t i = 0; i < 6; ++i) {
+        BOOST_TEST(std::abs(nsecs(back[i]) - nsecs(tps[i])) <= 1000);
+    }
+    BOOST_TEST(from_jd<tai_clock>(jd.data(), 6, back.data(), mask.data()) == 0u);
+    for (std::size_t i = 0; i < 6; ++i) {
+        BOOST_TEST(std::abs(nsecs(back[i]) - nsecs(tps[i])) <= 50000);
+    }
+
+    // out of range values are flagged and saturated instead of throwing
+    std::vector<double> bad = {1e9, -1e9, std::numeric_limits<double>::quiet_NaN(), 51544.5};
+    std::vector<utc_clock::time_point> saturated(bad.size());
+    std::vector<std::uint8_t> bad_mask(bad.size());
+    BOOST_TEST(from_mjd<utc_clock>(bad.data(), bad.size(), saturated.data(), bad_mask.data()) == 3u);
+    BOOST_TEST(nsecs(saturated[0]) == nsecs(utc_clock::time_point::max()));
+    BOOST_TEST(nsecs(saturated[1]) == nsecs(utc_clock::time_point::min()));
+    BOOST_TEST(nsecs(saturated[2]) == nsecs(utc_clock::time_point::max()));
+    BOOST_TEST(nsecs(saturated[3]) == nsecs(utc_clock::from_mjd(days{51544.5})));
+    BOOST_TEST((bad_mask == std::vector<std::uint8_t>{1, 1, 1, 0}));
+    std::vector<split_days> bad_split = {{std::numeric_limits<std::int64_t>::min(), 0.0},
+                                         {std::numeric_limits<std::int64_t>::max(), 0.0},
+                                         {2451544, 1.0},
+                                         {2451544, 0.5}};
+    BOOST_TEST(from_jd<utc_clock>(bad_split.data(), bad_split.size(), saturated.data(), bad_mask.data()) == 3u);
+    BOOST_TEST(nsecs(saturated[0]) == nsecs(utc_clock::time_point::min()));
+    BOOST_TEST(nsecs(saturated[1]) == nsecs(utc_clock::time_point::max()));
+    BOOST_TEST((bad_mask == std::vector<std::uint8_t>{1, 1, 1, 0}));
+}
+
+BOOST_AUTO_TEST_CASE(DriftSegmentsRoundTrip) {
+    // TAI - UTC is exact at the reference MJD of the drift terms
+    BOOST_TEST(nsecs(timescale_cast<tai_clock>(utc_clock::from_mjd(days{37300.0}))) -
+                       nsecs(utc_clock::from_mjd(days{37300.0})) ==
+               1422818000);
+    BOOST_TEST(nsecs(timescale_cast<tai_clock>(utc_clock::from_mjd(days{39126.0}))) -
+                       nsecs(utc_clock::from_mjd(days{39126.0})) ==
+               4313170000);
+
+    // walk the pre-1972 leap table entries, whose TAI - UTC drifts
+    int drifting = 0;
+    auto segment = find_timescale_segment<tai_clock>(utc_clock::from_mjd(days{37300.0}));
+    while (!segment.is_constant) {
+        ++drifting;
+        std::int64_t const first = nsecs(segment.first);
+        std::int64_t const last = nsecs(segment.last);
+        // TAI at which the next entry takes over, UTC -> TAI is ambiguous beyond it
+        std::int64_t const next_tai = nsecs(timescale_cast<tai_clock>(segment.last + sc::nanoseconds{1}));
+        auto utc = [](std::int64_t t) { return utc_clock::time_point{sc::nanoseconds{t}}; };
+        auto tai = [](std::int64_t t) { return tai_clock::time_point{sc::nanoseconds{t}}; };
+
+        // every nanosecond near both ends of the segment and evenly spread samples in between
+        std::vector<std::int64_t> samples;
+        for (std::int64_t k = 0; k < 20000; ++k) {
+            samples.push_back(first + k);
+            samples.push_back(last - k);
+            samples.push_back(first + (last - first) / 20000 * k + k % 997);
+        }
+        int utc_mismatches = 0;
+        int tai_mismatches = 0;
+        for (std::int64_t u : samples) {
+            std::int64_t const t = nsecs(timescale_cast<tai_clock>(utc(u)));
+            if (t < next_tai && nsecs(timescale_cast<utc_clock>(tai(t))) != u) {
+                ++utc_mismatches;
+            }
+            // TAI -> UTC gives the latest UTC not after the TAI value, also between the TAI values
+            // of consecutive UTC nanoseconds (TAI values skipped at the end of the entry map past it)
+            std::int64_t const t1 = t + u % 2;
+            std::int64_t const back = nsecs(timescale_cast<utc_clock>(tai(t1)));
+            bool const within = t1 < next_tai && back <= last;
+            if (within && (nsecs(timescale_cast<tai_clock>(utc(back))) > t1 ||
+                           (back < last && nsecs(timescale_cast<tai_clock>(utc(back + 1))) <= t1))) {
+                ++tai_mismatches;
+            }
+        }
+        BOOST_TEST(utc_mismatches == 0);
+        BOOST_TEST(tai_mismatches == 0);
+        segment = find_timescale_segment<tai_clock>(segment.last + sc::nanoseconds{1});
+    }
+    BOOST_TEST(drifting == 13);
+}
+
+BOOST_AUTO_TEST_CASE(FormatColumn) {
+    std::vector<std::int64_t> ns = {-1000000001LL, -1LL, 0LL, 1LL, 1238657199314159265LL,
+                                    -26392807668252446LL};
+    for (std::int64_t i = 0; i < 200000; ++i) {
+        ns.push_back(i * 9876543210987LL - 5000000000000000000LL);
+    }
+    std::vector<utc_clock::time_point> utc;
+    std::vector<tai_clock::time_point> tai;
+    for (auto n : ns) {
+        utc.push_back(utc_clock::time_point{sc::nanoseconds{n}});
+        tai.push_back(tai_clock::time_point{sc::nanoseconds{n}});
+    }
+    auto column = format_column(utc.data(), utc.size(), 1);
+    BOOST_TEST(column.size() == utc.size());
+    BOOST_TEST(column.data.size() == 30 * utc.size());
+    // appends to an existing column
+    format_column(tai.data(), tai.size(), column, 1);
+    BOOST_TEST(column.size() == utc.size() + tai.size());
+    BOOST_TEST(column.offsets.back() == static_cast<std::int64_t>(column.data.size()));
+    int mismatches = 0;
+    for (std::size_t i = 0; i < utc.size(); i += 7) {
+        mismatches += column[i] != to_string(utc[i]);
+        mismatches += column[utc.size() + i] != to_string(tai[i]);
+    }
+    BOOST_TEST(mismatches == 0);
+
+    auto threaded = format_column(utc.data(), utc.size(), 4);
+    format_column(tai.data(), tai.size(), threaded, 4);
+    BOOST_TEST((threaded.data == column.data));
+    BOOST_TEST((threaded.offsets == column.offsets));
+    BOOST_TEST(time_format<patterns::iso8601>::fixed_size<utc_clock>() == 30u);
+    BOOST_TEST(time_format<patterns::iso8601>::fixed_size<tt_clock>() == 29u);
+
+    auto fits = format_column<patterns::fits_date_obs>(tai.data(), 2);
+    BOOST_TEST(fits[0] == "1969-12-31T23:59:58.999");
+    BOOST_TEST(format_column(utc.data(), 0).empty());
+}
+
+BOOST_AUTO_TEST_CASE(TimestampParser) {
+    constexpr char iso[] = "2017-01-01T00:00:00.5Z";
+    static_assert(sniff_timestamp(iso, iso + sizeof(iso) - 1) == timestamp_format::iso8601_extended, "");
+    constexpr char mjd[] = "57754.25";
+    static_assert(sniff_timestamp(mjd, mjd + sizeof(mjd) - 1) == timestamp_format::mjd, "");
+    // eight digits alone are a basic date if they form one, and Unix seconds otherwise
+    constexpr char date[] = "20170101";
+    static_assert(sniff_timestamp(date, date + sizeof(date) - 1) == timestamp_format::iso8601_basic, "");
+    constexpr char seconds[] = "20170230";
+    static_assert(sniff_timestamp(seconds, seconds + sizeof(seconds) - 1) == timestamp_format::unix_seconds, "");
+
+    timestamp_parser<tai_clock> parser;
+    auto const utc = utc_clock::from_string("2017-01-01T06:00:00.5Z");
+    auto const tai = timescale_cast<tai_clock>(utc);
+    BOOST_TEST(nsecs(parser.parse("2017-01-01T06:00:00.5Z")) == nsecs(tai));
+    BOOST_TEST((parser.format() == timestamp_format::iso8601_extended));
+    BOOST_TEST(nsecs(parser.parse("20170101T060000,500Z")) == nsecs(tai));
+    BOOST_TEST((parser.format() == timestamp_format::iso8601_basic));
+    BOOST_TEST(nsecs(parser.parse("2017-01-01T06:00:37.5")) == nsecs(tai));
+    BOOST_TEST(nsecs(parser.parse("20170101T060037.5")) == nsecs(tai));
+    // FITS DATE-OBS, also as a date alone
+    BOOST_TEST(nsecs(parser.parse("2017-01-01T06:00:37.500")) == nsecs(tai));
+    BOOST_TEST(nsecs(parser.parse("2017-01-01")) == nsecs(tai_clock::from_string("2017-01-01T00:00:00")));
+    BOOST_TEST(nsecs(parser.parse("57754.25")) == nsecs(tai_clock::from_mjd(days{57754.25})));
+    BOOST_TEST((parser.format() == timestamp_format::mjd));
+    BOOST_TEST(nsecs(parser.parse("2457754.75")) == nsecs(tai_clock::from_mjd(days{57754.25})));
+    BOOST_TEST((parser.format() == timestamp_format::jd));
+    BOOST_TEST(nsecs(parser.parse("1483250400.5")) == nsecs(tai));
+    BOOST_TEST((parser.format() == timestamp_format::unix_seconds));
+    BOOST_TEST(nsecs(parser.parse("20170101")) == nsecs(tai_clock::from_string("2017-01-01T00:00:00")));
+    BOOST_TEST((parser.format() == timestamp_format::iso8601_basic));
+    BOOST_TEST(nsecs(parser.parse("20170101.0")) == nsecs(timescale_cast<tai_clock>(
+                                                            utc_clock::from_string("1970-08-22T10:48:21Z"))));
+    BOOST_TEST((parser.format() == timestamp_format::unix_seconds));
+    // exact decimal decoding, truncated to the nanosecond as in from_string
+    BOOST_TEST(nsecs(parser.parse("2017-01-01T00:00:00.9999999999")) ==
+               nsecs(tai_clock::from_string("2017-01-01T00:00:00.9999999999")));
+    BOOST_TEST(nsecs(parser.parse("20170101T000000.0000000015")) == 1483228800000000001LL);
+    BOOST_TEST(nsecs(parser.parse("1483228800.9999999999")) ==
+               nsecs(timescale_cast<tai_clock>(utc_clock::from_string("2017-01-01T00:00:00.999999999Z"))));
+    BOOST_TEST(nsecs(parser.parse("40587.000000000000012")) == 1);
+    BOOST_TEST(nsecs(parser.parse("-0.25")) == -3506738400000000000LL);
+    BOOST_TEST(nsecs(parser.parse("2440587.5")) == 0);
+    auto const unix = utc_clock::time_point{sc::nanoseconds{-100000000000000001LL}};
+    BOOST_TEST(nsecs(parser.parse("-100000000.000000001")) == nsecs(timescale_cast<tai_clock>(unix)));
+    BOOST_TEST(nsecs(parser.parse("1969-12-31T23:59:59.999999999")) == -1);
+
+    tai_clock::time_point tp;
+    for (const char* bad : {"", "x", "2017-13-01T00:00:00", "2017-02-29", "2017-01-01T24:00:00",
+                            "2017-01-01T00:00:00.", "2017-01-01T00:00:00Zx", "20170101T00:00:00", "57754.25.",
+                            "9999999.5", "1e9", "1300-01-01", "123456789012.0"}) {
+        BOOST_TEST(!parser.parse(bad, bad + std::strlen(bad), tp), bad);
+    }
+    BOOST_CHECK_THROW(parser.parse("2017-01-01T00:00"), std::invalid_argument);
+    // before the leap second table
+    BOOST_CHECK_THROW(parser.parse("1950-01-01T00:00:00Z"), std::invalid_argument);
+
+    timestamp_parser<utc_clock> locking(3);
+    BOOST_TEST(nsecs(locking.parse("57754.25")) == nsecs(utc_clock::from_mjd(days{57754.25})));
+    BOOST_TEST(nsecs(locking.parse("2017-01-01T00:00:00Z")) == nsecs(utc_clock::from_mjd(days{57754.0})));
+    BOOST_TEST(!locking.locked());
+    for (const char* s : {"57754.5", "57755", "57756.75"}) {
+        locking.parse(s);
+    }
+    BOOST_TEST(locking.locked());
+    BOOST_TEST((locking.format() == timestamp_format::mjd));
+    BOOST_TEST(nsecs(locking.parse("1.5")) == -(40587LL - 1) * 86400000000000LL + 43200000000000LL);
+    // a 7 digit value is taken as an MJD too once locked, and is out of range
+    BOOST_CHECK_THROW(locking.parse("2457754.5"), std::invalid_argument);
+    BOOST_CHECK_THROW(locking.parse("2017-01-01T00:00:00Z"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(Literals) {
+    using namespace astrochrono::literals;
+
+    constexpr auto utc = "2017-01-01T00:00:00Z"_utc;
+    static_assert(utc.time_since_epoch().count() == 1483228800000000000, "UTC literal");
+    constexpr auto tai = "2017-01-01T00:00:00Z"_tai;
+    static_assert(tai.time_since_epoch().count() == 1483228837000000000, "UTC to TAI literal");
+    constexpr auto tt = "20170101T000000Z"_tt;
+    static_assert(tt.time_since_epoch().count() == 1483228869184000000, "UTC to TT literal");
+    constexpr auto tai_native = "2017-01-01T00:00:37"_tai;
+    static_assert(tai_native == tai, "TAI literal without Z is on TAI");
+    // a leap second label normalizes to the next minute, as in from_string
+    static_assert("2016-12-31T23:59:60.5Z"_tai.time_since_epoch().count() == 1483228837500000000,
+                  "leap second label");
+    static_assert("2017-01-01"_tt.time_since_epoch().count() == 1483228800000000000, "date alone");
+
+    constexpr auto mjd = 57754.5_mjd_tai;
+    static_assert(mjd.time_since_epoch().count() == 1483272000000000000, "MJD literal");
+    static_assert((57754_mjd_utc).time_since_epoch().count() == 1483228800000000000, "integral MJD literal");
+    static_assert((2457754.5_jd_tt).time_since_epoch().count() == 1483228800000000000, "JD literal");
+    static_assert((40587.000000000000012_mjd_tai).time_since_epoch().count() == 1, "MJD literal rounding");
+
+    // the compile time conversion agrees with the runtime one, also while TAI - UTC drifted
+    BOOST_TEST(nsecs(tai) ==
+               nsecs(timescale_cast<tai_clock>(utc_clock::from_string("2017-01-01T00:00:00.000000000Z"))));
+    constexpr auto drift = "1965-06-15T12:34:56.789012345Z"_tai;
+    BOOST_TEST(nsecs(drift) ==
+               nsecs(timescale_cast<tai_clock>(utc_clock::from_string("1965-06-15T12:34:56.789012345Z"))));
+    for (std::size_t i = 0; i < detail::leap_second_count; ++i) {
+        std::int64_t const when = detail::leap_when_utc(detail::leap_seconds[i]);
+        for (std::int64_t t : {when, when + 1, when + std::int64_t{12345678987654}, when - 1}) {
+            if (i == 0 && t < when) {
+                continue;
+            }
+            BOOST_TEST(detail::utc_to_tai_nsecs(t) ==
+                       nsecs(timescale_cast<tai_clock>(utc_clock::time_point{sc::nanoseconds{t}})));
+        }
+    }
+
+    // outside a constant expression, malformed string literals and UTC before 1961 throw
+    BOOST_CHECK_THROW("2017-13-01T00:00:00Z"_utc, std::invalid_argument);
+    BOOST_CHECK_THROW("57754.5"_tai, std::invalid_argument);
+    BOOST_CHECK_THROW("1960-01-01T00:00:00Z"_tai, std::domain_error);
+}
+
+namespace {
+
+struct tt_event {
+    int id;
+    tt_clock::time_point time;
+};
+
+// All time points of the sources of a merge converted to ToClock, stably sorted by their TAI instant
+template <typename ToClock>
+class merge_reference {
+public:
+    using value_type = typename timescale_merge<ToClock>::value_type;
+
+    template <typename TimePoint>
+    void add(std::vector<TimePoint> const &tps) {
+        for (std::size_t i = 0; i < tps.size(); ++i) {
+            entries.push_back({timescale_cast<tai_clock>(tps[i]), {timescale_cast<ToClock>(tps[i]), sources, i}});
+        }
+        ++sources;
+    }
+
+    std::vector<value_type> sorted() {
+        std::stable_sort(entries.begin(), entries.end(),
+                         [](entry const &a, entry const &b) { return a.first < b.first; });
+        std::vector<value_type> values;
+        for (auto const &e : entries) {
+            values.push_back(e.second);
+        }
+        return values;
+    }
+
+    using entry = std::pair<tai_clock::time_point, value_type>;
+    std::vector<entry> entries;
+    std::size_t sources = 0;
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(TimescaleMerge) {
+    using namespace astrochrono::literals;
+
+    // streams around the leap second at the end of 2016 and in the 1960s, when TAI - UTC drifted
+    std::vector<utc_clock::time_point> utc;
+    std::vector<tai_clock::time_point> tai;
+    std::vector<tt_event> events;
+    std::vector<tt_clock::time_point> tt;
+    std::vector<utc_clock::time_point> drift;
+    std::vector<tai_clock::time_point> empty;
+    for (int i = 0; i < 1000; ++i) {
+        utc.push_back("2016-12-31T23:59:00Z"_utc + sc::nanoseconds{i * 123456789LL});
+        tai.push_back("2017-01-01T00:00:10"_tai + sc::nanoseconds{i * 98765432LL});
+        events.push_back({i, "2017-01-01T00:00:40"_tt + sc::seconds{i / 3}});
+        drift.push_back("1963-06-01T00:00:00Z"_utc + sc::hours{i * 24});
+    }
+    // equal keys across sources keep the order of the sources
+    utc.push_back("2017-01-01T00:05:00Z"_utc);
+    tai.push_back("2017-01-01T00:05:37"_tai);
+    for (auto const &e : events) {
+        tt.push_back(e.time);
+    }
+
+    timescale_merge<tai_clock> merge(7);
+    merge.add_source(utc.begin(), utc.end());
+    merge.add_source(tai.begin(), tai.end());
+    merge.add_source(events.begin(), events.end(), [](tt_event const &e) { return e.time; });
+    merge.add_source(empty.begin(), empty.end());
+    merge.add_source(drift.data(), drift.data() + drift.size());
+    BOOST_TEST(merge.sources() == 5u);
+
+    merge_reference<tai_clock> reference;
+    reference.add(utc);
+    reference.add(tai);
+    reference.add(tt);
+    reference.add(empty);
+    reference.add(drift);
+    auto const expected = reference.sorted();
+
+    std::vector<timescale_merge<tai_clock>::value_type> merged(expected.size() + 1);
+    std::size_t n = merge.next(merged.data(), 10);
+    n += merge.next(merged.data() + n, merged.size() - n);
+    BOOST_TEST_REQUIRE(n == expected.size());
+    for (std::size_t i = 0; i < n; ++i) {
+        BOOST_TEST(nsecs(merged[i].time) == nsecs(expected[i].time));
+        BOOST_TEST(merged[i].source == expected[i].source);
+        BOOST_TEST(merged[i].index == expected[i].index);
+    }
+    BOOST_TEST(!merge.next(merged[0]));
+    BOOST_CHECK_THROW(merge.add_source(utc.begin(), utc.end()), std::logic_error);
+
+    // into UTC, through the leap second where the UTC time points repeat
+    timescale_merge<utc_clock> to_utc;
+    to_utc.add_source(tai.begin(), tai.end());
+    to_utc.add_source(utc.begin(), utc.end());
+    merge_reference<utc_clock> utc_reference;
+    utc_reference.add(tai);
+    utc_reference.add(utc);
+    timescale_merge<utc_clock>::value_type v;
+    for (auto const &e : utc_reference.sorted()) {
+        BOOST_TEST_REQUIRE(to_utc.next(v));
+        BOOST_TEST(nsecs(v.time) == nsecs(e.time));
+        BOOST_TEST(v.source == e.source);
+        BOOST_TEST(v.index == e.index);
+    }
+    BOOST_TEST(!to_utc.next(v));
+
+    timescale_merge<tt_clock> none;
+    timescale_merge<tt_clock>::value_type w;
+    BOOST_TEST(!none.next(w));
+}
+
+BOOST_AUTO_TEST_CASE(BarycentricTimes) {
+    using namespace astrochrono::literals;
+
+    // light travel time and TDB - TT from the IAU SOFA epv00, dtdb and c2t06a routines (with
+    // UT1 = UTC), to be matched to within 10 microseconds between 1961 and 2100
+    struct reference {
+        tt_clock::time_point tt;
+        sky_direction direction;
+        double barycentric;
+        double heliocentric;
+    };
+    reference const references[] = {
+            {"1962-03-10T03:00:00"_tt, {0.4, -0.2}, -416.6059989, -415.7893823},
+            {"1975-03-01T00:00:00"_tt, {1.0, 0.3}, -97.1439203, -96.2204104},
+            {"1991-09-02T21:15:00"_tt, {3.3, 1.3}, -184.2567746, -184.2675931},
+            {"2010-07-15T06:30:00"_tt, {4.5, -1.1}, 337.5858263, 338.0681019},
+            {"2030-11-20T18:00:00"_tt, {2.2, 0.9}, 228.2419460, 227.6145019},
+            {"2061-05-30T12:00:00"_tt, {5.9, 0.05}, -15.7229575, -17.5508010},
+            {"2099-12-01T09:45:00"_tt, {0.1, -0.6}, 86.2154682, 82.7440340},
+    };
+    observatory_position const pachon{1818939.0, -5208471.0, -3195172.0};
+    for (auto const &r : references) {
+        tdb_clock::time_point b;
+        tt_clock::time_point h;
+        barycentric_times(&r.tt, 1, r.direction, pachon, &b);
+        heliocentric_times(&r.tt, 1, r.direction, pachon, &h);
+        double const barycentric = (nsecs(b) - nsecs(r.tt)) * 1e-9;
+        double const heliocentric = (nsecs(h) - nsecs(r.tt)) * 1e-9;
+        BOOST_TEST(std::abs(barycentric - r.barycentric) < 1e-5);
+        BOOST_TEST(std::abs(heliocentric - r.heliocentric) < 1e-5);
+    }
+    std::int64_t const tdb_minus_tt = nsecs(to_tdb("1975-03-01T00:00:00"_tt)) - nsecs("1975-03-01T00:00:00"_tt);
+    BOOST_TEST(std::abs(tdb_minus_tt - 1365000) < 20000);
+
+    // photons over a night, the cached evaluation agrees with the evaluation per photon
+    std::vector<tt_clock::time_point> photons;
+    for (int i = 0; i < 5000; ++i) {
+        photons.push_back("2021-03-04T00:00:00"_tt + sc::microseconds{i * 7654321LL});
+    }
+    sky_direction const crab{1.4595, 0.3842};
+    std::vector<tdb_clock::time_point> cached(photons.size());
+    std::vector<tdb_clock::time_point> exact(photons.size());
+    barycentric_times(photons.data(), photons.size(), crab, pachon, cached.data());
+    barycentric_times(photons.data(), photons.size(), crab, pachon, exact.data(), sc::nanoseconds{0});
+    std::int64_t worst = 0;
+    for (std::size_t i = 0; i < photons.size(); ++i) {
+        worst = std::max(worst, std::abs(nsecs(cached[i]) - nsecs(exact[i])));
+    }
+    BOOST_TEST(worst < 1000);
+
+    // UTC input is converted to TT, heliocentric times stay on UTC
+    std::vector<utc_clock::time_point> utc(photons.size());
+    timescale_cast<utc_clock>(photons.data(), photons.size(), utc.data());
+    std::vector<tdb_clock::time_point> from_utc(photons.size());
+    barycentric_times(utc.data(), utc.size(), crab, pachon, from_utc.data());
+    for (std::size_t i = 0; i < photons.size(); ++i) {
+        BOOST_TEST(nsecs(from_utc[i]) == nsecs(cached[i]));
+    }
+    std::vector<utc_clock::time_point> utc_helio(photons.size());
+    std::vector<tt_clock::time_point> tt_helio(photons.size());
+    heliocentric_times(utc.data(), utc.size(), crab, pachon, utc_helio.data());
+    heliocentric_times(photons.data(), photons.size(), crab, pachon, tt_helio.data());
+    BOOST_TEST(nsecs(timescale_cast<tt_clock>(utc_helio[100])) == nsecs(tt_helio[100]));
+
+    utc_clock::time_point const too_early = "1960-06-01T00:00:00Z"_utc;
+    tdb_clock::time_point b;
+    BOOST_CHECK_THROW(barycentric_times(&too_early, 1, crab, pachon, &b), std::domain_error);
+}
+
+BOOST_AUTO_TEST_CASE(Trace) {
+    trace_event const step = register_trace_event("step");
+    trace_event const quote = register_trace_event("say \"hi\"");
+    BOOST_TEST(register_trace_event("step") == step);
+    dump_trace();
+
+    auto const before = tai_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 1000; ++i) {
+                ASTROCHRONO_TRACE_SCOPE(step);
+                ASTROCHRONO_TRACE(quote);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto const after = tai_clock::now();
+
+    trace_dump const dump = dump_trace();
+    BOOST_TEST(dump.dropped == 0u);
+    BOOST_TEST_REQUIRE(dump.records.size() == 12000u);
+    BOOST_TEST(dump.events.at(step) == "step");
+    BOOST_TEST(std::is_sorted(dump.records.begin(), dump.records.end(),
+                              [](trace_record const &a, trace_record const &b) { return a.time < b.time; }));
+    // now() has microsecond resolution, the anchors are read with nanoseconds
+    BOOST_TEST(nsecs(dump.records.front().time) >= nsecs(before - sc::milliseconds{1}));
+    BOOST_TEST(nsecs(dump.records.back().time) <= nsecs(after + sc::milliseconds{1}));
+    std::map<std::uint32_t, int> per_thread;
+    for (auto const &r : dump.records) {
+        ++per_thread[r.thread];
+    }
+    BOOST_TEST(per_thread.size() == 4u);
+    for (auto const &t : per_thread) {
+        BOOST_TEST(t.second == 3000);
+    }
+    // the threads have exited, their records have all been dumped
+    BOOST_TEST(dump_trace().records.empty());
+
+    // a full ring keeps the most recent records
+    set_trace_buffer_size(100);
+    std::thread([&] {
+        for (int i = 0; i < 1000; ++i) {
+            trace(step);
+        }
+    }).join();
+    set_trace_buffer_size(65536);
+    trace_dump const wrapped = dump_trace();
+    BOOST_TEST(wrapped.records.size() == 128u);
+    BOOST_TEST(wrapped.dropped == 872u);
+
+    std::stringstream binary;
+    write_trace(binary, dump);
+    trace_dump const read = read_trace(binary);
+    BOOST_TEST(read.events == dump.events, tt::per_element());
+    BOOST_TEST_REQUIRE(read.records.size() == dump.records.size());
+    BOOST_TEST(nsecs(read.records.back().time) == nsecs(dump.records.back().time));
+    BOOST_TEST(static_cast<std::uint32_t>(read.records.back().phase) ==
+               static_cast<std::uint32_t>(dump.records.back().phase));
+    std::istringstream garbage("not a trace");
+    BOOST_CHECK_THROW(read_trace(garbage), std::runtime_error);
+
+    trace_dump small;
+    small.events = {"step", "say \"hi\""};
+    small.records = {{"2020-01-01T00:00:00"_tai, 0, 0, trace_phase::begin},
+                     {"2020-01-01T00:00:00.000001234"_tai, 0, 1, trace_phase::instant},
+                     {"2020-01-01T00:00:01"_tai, 0, 0, trace_phase::end}};
+    std::ostringstream text;
+    write_trace_text(text, small);
+    BOOST_TEST(text.str() ==
+               "# time (TAI)\tthread\tphase\tevent\n"
+               "2020-01-01T00:00:00.000000000\t0\tbegin\tstep\n"
+               "2020-01-01T00:00:00.000001234\t0\tinstant\tsay \"hi\"\n"
+               "2020-01-01T00:00:01.000000000\t0\tend\tstep\n");
+    std::ostringstream chrome;
+    write_trace_chrome(chrome, small);
+    BOOST_TEST(chrome.str() ==
+               "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"origin\":\"2020-01-01T00:00:00.000000000 TAI\","
+               "\"dropped\":0},\"traceEvents\":[\n"
+               "{\"name\":\"step\",\"ph\":\"B\",\"ts\":0.000,\"pid\":0,\"tid\":0},\n"
+               "{\"name\":\"say \\\"hi\\\"\",\"ph\":\"i\",\"s\":\"t\",\"ts\":1.234,\"pid\":0,\"tid\":0},\n"
+               "{\"name\":\"step\",\"ph\":\"E\",\"ts\":1000000.000,\"pid\":0,\"tid\":0}\n"
+               "]}\n");
+}
+
+BOOST_AUTO_TEST_CASE(IntervalSet) {
+    using utc_set = interval_set<utc_clock>;
+    using tt_set = interval_set<tt_clock>;
+    auto const t0 = "2016-12-31T23:59:00Z"_utc;
+    auto const s = [&](int first, int last) { return utc_set::interval{t0 + sc::seconds{first}, t0 + sc::seconds{last}}; };
+
+    // unsorted, overlapping, adjacent and empty intervals are normalized
+    utc_set const a{s(30, 40), s(0, 10), s(5, 15), s(15, 20), s(50, 50)};
+    BOOST_TEST_REQUIRE(a.size() == 2u);
+    BOOST_TEST(nsecs(a[0].first) == nsecs(t0));
+    BOOST_TEST(nsecs(a[0].last) == nsecs(t0 + sc::seconds{20}));
+    BOOST_TEST(a.exposure().count() == sc::nanoseconds{sc::seconds{30}}.count());
+    BOOST_TEST(a.contains(t0 + sc::seconds{19}));
+    BOOST_TEST(!a.contains(t0 + sc::seconds{20}));
+
+    // an interval across the leap second lasts one second longer on TAI
+    utc_set const leap{s(55, 65)};
+    BOOST_TEST(leap.exposure().count() == sc::nanoseconds{sc::seconds{11}}.count());
+    BOOST_TEST(leap.contains(timescale_cast<tai_clock>(t0 + sc::seconds{60}) - sc::milliseconds{500}));
+    BOOST_TEST(nsecs(leap[0].last) == nsecs(t0 + sc::seconds{65}));
+    // a boundary within the leap second is the start of the next minute on UTC
+    auto const in_leap = timescale_cast<tai_clock>(t0 + sc::seconds{60}) - sc::milliseconds{300};
+    interval_set<tai_clock> const to_leap{{in_leap - sc::seconds{2}, in_leap}};
+    BOOST_TEST(nsecs(timescale_cast<utc_clock>(to_leap)[0].last) == nsecs(t0 + sc::seconds{60}));
+    BOOST_TEST(nsecs(timescale_cast<utc_clock>(to_leap)[0].first) ==
+               nsecs(t0 + sc::seconds{58} + sc::milliseconds{700}));
+    BOOST_TEST((timescale_cast<utc_clock>(to_leap) == to_leap));
+
+    // set operations across time scales against a reference on a grid of seconds
+    tt_set const b{{timescale_cast<tt_clock>(t0 + sc::seconds{8}), timescale_cast<tt_clock>(t0 + sc::seconds{35})},
+                   {timescale_cast<tt_clock>(t0 + sc::seconds{62}), timescale_cast<tt_clock>(t0 + sc::seconds{70})}};
+    utc_set const c = a | leap;
+    for (int i = -5; i < 80; ++i) {
+        auto const t = t0 + sc::seconds{i} + sc::milliseconds{1};
+        BOOST_TEST((c | b).contains(t) == (c.contains(t) || b.contains(t)));
+        BOOST_TEST((c & b).contains(t) == (c.contains(t) && b.contains(t)));
+        BOOST_TEST((c - b).contains(t) == (c.contains(t) && !b.contains(t)));
+        BOOST_TEST((c ^ b).contains(t) == (c.contains(t) != b.contains(t)));
+        BOOST_TEST((~c).contains(t) == !c.contains(t));
+    }
+    BOOST_TEST(((c & b) == (b & c)));
+    BOOST_TEST((~~c == c));
+    BOOST_TEST((c - c).empty());
+    BOOST_TEST((~utc_set{}).exposure().count() == sc::nanoseconds::max().count());
+    BOOST_TEST(nsecs((~utc_set{})[0].first) == nsecs(utc_clock::time_point::min()));
+    BOOST_TEST((~~utc_set{}).empty());
+    utc_set d = a;
+    d.insert(t0 + sc::seconds{20}, t0 + sc::seconds{30});
+    BOOST_TEST((d == utc_set{s(0, 40)}));
+
+    // masking sorted events on another time scale matches contains
+    std::vector<tt_clock::time_point> events;
+    for (int i = 0; i < 1000; ++i) {
+        events.push_back(timescale_cast<tt_clock>(t0) + sc::milliseconds{i * 83});
+    }
+    std::vector<std::uint8_t> mask(events.size());
+    std::size_t const inside = c.mask(events.data(), events.size(), mask.data());
+    std::size_t expected = 0;
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        BOOST_TEST(int{mask[i]} == (c.contains(events[i]) ? 1 : 0));
+        expected += c.contains(events[i]);
+    }
+    BOOST_TEST(inside == expected);
+    std::vector<tt_clock::time_point> selected(events.size());
+    BOOST_TEST_REQUIRE(c.filter(events.data(), events.size(), selected.data()) == inside);
+    selected.resize(inside);
+    BOOST_TEST(
+            std::all_of(selected.begin(), selected.end(), [&](tt_clock::time_point t) { return c.contains(t); }));
+    BOOST_TEST(utc_set{}.mask(events.data(), events.size(), mask.data()) == 0u);
+    BOOST_TEST((~utc_set{}).mask(events.data(), events.size(), mask.data()) == events.size());
+}
+
+BOOST_AUTO_TEST_CASE(StdChrono) {
+    auto const utc = "2017-01-01T00:00:00Z"_utc;
+    auto const tai = timescale_cast<tai_clock>(utc);
+    auto const sys = std::chrono::system_clock::from_time_t(1483228800);
+    BOOST_TEST(nsecs(to_sys(utc)) == nsecs(sys));
+    BOOST_TEST(nsecs(to_sys(tai)) == nsecs(sys));
+    BOOST_TEST(nsecs(to_sys(timescale_cast<tt_clock>(utc))) == nsecs(sys));
+    BOOST_TEST(nsecs(from_sys<utc_clock>(sys)) == nsecs(utc));
+    BOOST_TEST(nsecs(from_sys<tai_clock>(sys)) == nsecs(tai));
+
+    // arrays across the leap second and longer than a block
+    std::vector<tai_clock::time_point> tais;
+    for (int i = 0; i < 3000; ++i) {
+        tais.push_back(tai - sc::seconds{5} + sc::milliseconds{3 * i});
+    }
+    std::vector<std::chrono::system_clock::time_point> syss(tais.size());
+    to_sys(tais.data(), tais.size(), syss.data());
+    std::vector<tai_clock::time_point> back(tais.size());
+    from_sys<tai_clock>(syss.data(), syss.size(), back.data());
+    for (std::size_t i = 0; i < tais.size(); i += 7) {
+        BOOST_TEST(nsecs(syss[i]) == nsecs(to_sys(tais[i])));
+        BOOST_TEST(nsecs(back[i]) == nsecs(from_sys<tai_clock>(syss[i])));
+    }
+    std::vector<utc_clock::time_point> utcs(tais.size());
+    timescale_cast<utc_clock>(tais.data(), tais.size(), utcs.data());
+    to_sys(utcs.data(), utcs.size(), syss.data());
+    BOOST_TEST(nsecs(utcs[2999]) == nsecs(syss[2999]));
+
+#if defined(__cpp_lib_chrono) && __cpp_lib_chrono >= 201907L
+    using std_utc = std::chrono::utc_clock;
+    using std_tai = std::chrono::tai_clock;
+    BOOST_TEST(nsecs(std::chrono::clock_cast<std::chrono::system_clock>(utc)) == nsecs(sys));
+    BOOST_TEST(nsecs(std::chrono::clock_cast<utc_clock>(sys)) == nsecs(utc));
+    BOOST_TEST(nsecs(std::chrono::clock_cast<std_utc>(tai)) == nsecs(std::chrono::clock_cast<std_utc>(sys)));
+    BOOST_TEST(nsecs(std::chrono::clock_cast<std_tai>(tai)) == nsecs(std::chrono::clock_cast<std_tai>(sys)));
+    BOOST_TEST(nsecs(std::chrono::clock_cast<tai_clock>(std::chrono::clock_cast<std_tai>(tai))) == nsecs(tai));
+    BOOST_TEST(nsecs(std::chrono::clock_cast<std_tai>(timescale_cast<tt_clock>(tai))) ==
+               nsecs(std::chrono::clock_cast<std_tai>(tai)));
+    std::vector<std_tai::time_point> std_tais(tais.size());
+    astrochrono::clock_cast(tais.data(), tais.size(), std_tais.data());
+    BOOST_TEST(nsecs(std_tais[1234]) == nsecs(std::chrono::clock_cast<std_tai>(tais[1234])));
+    // through std::chrono::utc_clock and its own leap second table, which holds the last
+    // system_clock value before the 2017 leap second during it
+    std::vector<std::chrono::system_clock::time_point> via_std(tais.size());
+    astrochrono::clock_cast(tais.data(), tais.size(), via_std.data());
+    to_sys(tais.data(), tais.size(), syss.data());
+    for (std::size_t i = 0; i < tais.size(); ++i) {
+        if (tais[i] < tai - sc::seconds{1} || tais[i] >= tai) {
+            BOOST_TEST(nsecs(via_std[i]) == nsecs(syss[i]));
+        } else {
+            BOOST_TEST(nsecs(via_std[i]) == nsecs(sys - std::chrono::system_clock::duration{1}));
+        }
+    }
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(TimeBins) {
+    // ten minute bins over a day from MJD 59000 TT
+    auto const origin = tt_clock::from_mjd(59000.0);
+    time_bins<tt_clock> const bins(origin, sc::minutes{10}, 144);
+    BOOST_TEST(bins.size() == 144u);
+    BOOST_TEST(nsecs(bins.upper(143)) == nsecs(origin + sc::hours{24}));
+    BOOST_TEST(bins.find(origin) == 0);
+    BOOST_TEST(bins.find(origin + sc::minutes{10} - sc::nanoseconds{1}) == 0);
+    BOOST_TEST(bins.find(origin + sc::minutes{10}) == 1);
+    BOOST_TEST(bins.find(origin - sc::nanoseconds{1}) == time_bins<tt_clock>::outside);
+    BOOST_TEST(bins.find(origin + sc::hours{24}) == time_bins<tt_clock>::outside);
+    BOOST_TEST(bins.find(tt_clock::time_point::min()) == time_bins<tt_clock>::outside);
+    // TAI events are binned on TT
+    BOOST_TEST(bins.find(timescale_cast<tai_clock>(origin + sc::minutes{25})) == 2);
+
+    std::vector<std::int64_t> const edges(bins.edges());
+    auto const reference = [&](tt_clock::time_point tp) {
+        auto const t = nsecs(tp);
+        std::size_t const upper = std::upper_bound(edges.begin(), edges.end(), t) - edges.begin();
+        return upper == 0 || upper == edges.size() ? -1 : static_cast<int>(upper - 1);
+    };
+
+    // sorted and unsorted events, including some outside the day
+    std::vector<tt_clock::time_point> sorted;
+    for (std::int64_t i = -1000; i < 90000; ++i) {
+        sorted.push_back(origin + sc::nanoseconds{i * 987654321LL});
+    }
+    std::vector<tt_clock::time_point> shuffled(sorted);
+    std::reverse(shuffled.begin() + 1000, shuffled.end());
+    std::swap(shuffled[5], shuffled[70000]);
+    for (auto const *events : {&sorted, &shuffled}) {
+        std::vector<time_bins<tt_clock>::index_type> index(events->size());
+        bins.assign(events->data(), events->size(), index.data());
+        std::size_t mismatches = 0;
+        for (std::size_t i = 0; i < events->size(); ++i) {
+            mismatches += index[i] != reference((*events)[i]);
+        }
+        BOOST_TEST(mismatches == 0u);
+    }
+
+    // histograms, split over threads or not and on another time scale
+    std::vector<std::uint64_t> expected(bins.size());
+    std::size_t expected_outside = 0;
+    for (auto const &tp : sorted) {
+        int const b = reference(tp);
+        b < 0 ? ++expected_outside : ++expected[b];
+    }
+    BOOST_TEST(bins.histogram(sorted.data(), sorted.size(), 1) == expected, tt::per_element());
+    BOOST_TEST(bins.histogram(shuffled.data(), shuffled.size(), 4) == expected, tt::per_element());
+    std::vector<tai_clock::time_point> tai(shuffled.size());
+    timescale_cast<tai_clock>(shuffled.data(), shuffled.size(), tai.data());
+    std::vector<std::uint64_t> counts(bins.size(), 1);
+    BOOST_TEST(bins.histogram(tai.data(), tai.size(), counts.data(), 3) == expected_outside);
+    BOOST_TEST(counts[17] == expected[17] + 1);
+
+    // enough unsorted events for several threads, which fill partial histograms and then sum them
+    // by slices of bins, against a single thread
+    std::size_t const many_size = 9 * detail::min_binning_chunk;
+    std::vector<tt_clock::time_point> many;
+    for (std::size_t i = 0; i < many_size; ++i) {
+        std::int64_t const step = static_cast<std::int64_t>(i * 7919 % many_size);
+        many.push_back(origin + sc::nanoseconds{step * 150000000LL - 1000000000LL});
+    }
+    std::vector<std::uint64_t> single(bins.size());
+    std::size_t const single_outside = bins.histogram(many.data(), many.size(), single.data(), 1);
+    BOOST_TEST(single_outside > 0u);
+    for (unsigned threads : {2u, 3u, 4u, 7u}) {
+        std::vector<std::uint64_t> parallel(bins.size());
+        BOOST_TEST(bins.histogram(many.data(), many.size(), parallel.data(), threads) == single_outside);
+        BOOST_TEST(parallel == single, tt::per_element());
+    }
+
+    // a conversion error on the calling thread or on another one reaches the caller
+    std::vector<utc_clock::time_point> early(400000, utc_clock::from_string("2000-01-01T00:00:00Z"));
+    std::fill(early.begin() + 350000, early.end(), utc_clock::from_string("1960-01-01T00:00:00Z"));
+    time_bins<tai_clock> const tai_bins(tai_clock::from_mjd(51544.0), sc::hours{1}, 24);
+    BOOST_CHECK_THROW(tai_bins.histogram(early.data(), early.size(), 4), std::domain_error);
+    std::fill(early.begin(), early.end(), utc_clock::from_string("1960-01-01T00:00:00Z"));
+    BOOST_CHECK_THROW(tai_bins.histogram(early.data(), early.size(), 4), std::domain_error);
+
+    // bins of varying width
+    std::vector<tt_clock::time_point> varying{origin, origin + sc::hours{1}, origin + sc::hours{1} + sc::seconds{1},
+                                              origin + sc::hours{6}};
+    time_bins<tt_clock> const irregular(varying);
+    BOOST_TEST(!irregular.is_uniform());
+    auto const histogram = irregular.histogram(shuffled.data(), shuffled.size(), 2);
+    BOOST_TEST_REQUIRE(histogram.size() == 3u);
+    BOOST_TEST(histogram[0] == 3645u);
+    BOOST_TEST(histogram[1] == 2u);
+    BOOST_TEST(histogram[2] == 18223u);
+    BOOST_TEST(irregular.find(origin + sc::minutes{61}) == 2);
+
+    BOOST_CHECK_THROW(time_bins<tt_clock>(origin, sc::seconds{0}, 10), std::invalid_argument);
+    BOOST_CHECK_THROW(time_bins<tt_clock>(std::vector<tt_clock::time_point>{origin, origin}), std::invalid_argument);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
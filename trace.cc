@@ -0,0 +1,140 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2018  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+
+// astrochrono-trace: convert a binary trace written by write_trace to text or Chrome trace JSON
+//
+//     astrochrono-trace [options] [file]
+//
+// Reads the dump from the file or standard input and writes it to standard output.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "astrochrono_trace.h"
+
+using namespace astrochrono;
+
+namespace {
+
+enum class trace_format { text, chrome };
+
+struct options {
+    trace_format format = trace_format::text;
+    std::string input = "-";
+    std::string output = "-";
+};
+
+void usage(const char* name) {
+    std::cerr << "usage: " << name << " [options] [file]\n"
+              << "Convert a binary trace dump (or standard input) to text or Chrome trace JSON.\n"
+              << "  -f, --format text|chrome  output format (text)\n"
+              << "  -o, --output FILE         output file (standard output)\n";
+}
+
+trace_format parse_format(std::string const& s) {
+    if (s == "text") {
+        return trace_format::text;
+    } else if (s == "chrome") {
+        return trace_format::chrome;
+    }
+    throw std::invalid_argument("Unknown format: " + s);
+}
+
+options parse_options(int argc, char** argv) {
+    options opts;
+    bool input_given = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string const arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+        if (arg == "-f" || arg == "--format") {
+            opts.format = parse_format(value());
+        } else if (arg == "-o" || arg == "--output") {
+            opts.output = value();
+        } else if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            std::exit(0);
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            throw std::invalid_argument("Unknown option: " + arg);
+        } else if (input_given) {
+            throw std::invalid_argument("Only one input file may be given");
+        } else {
+            opts.input = arg;
+            input_given = true;
+        }
+    }
+    return opts;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    options opts;
+    try {
+        opts = parse_options(argc, argv);
+    } catch (std::exception const& e) {
+        std::cerr << argv[0] << ": " << e.what() << "\n";
+        usage(argv[0]);
+        return 2;
+    }
+    try {
+        trace_dump dump;
+        if (opts.input == "-") {
+            dump = read_trace(std::cin);
+        } else {
+            std::ifstream in(opts.input, std::ios::binary);
+            if (!in) {
+                throw std::runtime_error("Cannot open " + opts.input);
+            }
+            dump = read_trace(in);
+        }
+        std::ofstream file;
+        if (opts.output != "-") {
+            file.open(opts.output);
+            if (!file) {
+                throw std::runtime_error("Cannot open " + opts.output);
+            }
+        }
+        std::ostream& out = opts.output == "-" ? std::cout : file;
+        if (opts.format == trace_format::chrome) {
+            write_trace_chrome(out, dump);
+        } else {
+            write_trace_text(out, dump);
+        }
+        if (!out.flush()) {
+            throw std::runtime_error("write error");
+        }
+    } catch (std::exception const& e) {
+        std::cerr << argv[0] << ": " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}